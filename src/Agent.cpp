@@ -43,281 +43,151 @@
 #include <limits>
 
 #include "Definitions.h"
+#include "FastMath.h"
 #include "Goal.h"
 #include "KdTree.h"
+#include "NavigationGrid.h"
+#include "Trajectory.h"
 
 namespace hrvo {
-#if HRVO_DIFFERENTIAL_DRIVE
-	const float HRVO_PI = 3.141592653589793f;
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-
-	Agent::Agent(Simulator *simulator) : simulator_(simulator), goalNo_(0), maxNeighbors_(0), goalRadius_(0.0f), maxAccel_(0.0f), maxSpeed_(0.0f), neighborDist_(0.0f), orientation_(0.0f), prefSpeed_(0.0f), radius_(0.0f), uncertaintyOffset_(0.0f),
-#if HRVO_DIFFERENTIAL_DRIVE
-		leftWheelSpeed_(0.0f), rightWheelSpeed_(0.0f), timeToOrientation_(0.0f), wheelTrack_(0.0f),
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-		reachedGoal_(false) { }
-
-	Agent::Agent(Simulator *simulator, const Vector2 &position, std::size_t goalNo) : simulator_(simulator), newVelocity_(simulator_->defaults_->velocity_), position_(position), velocity_(simulator_->defaults_->velocity_), goalNo_(goalNo), maxNeighbors_(simulator_->defaults_->maxNeighbors_), goalRadius_(simulator_->defaults_->goalRadius_), maxAccel_(simulator_->defaults_->maxAccel_), maxSpeed_(simulator_->defaults_->maxSpeed_), neighborDist_(simulator_->defaults_->neighborDist_), orientation_(simulator_->defaults_->orientation_), prefSpeed_(simulator_->defaults_->prefSpeed_), radius_(simulator_->defaults_->radius_), uncertaintyOffset_(simulator_->defaults_->uncertaintyOffset_),
-#if HRVO_DIFFERENTIAL_DRIVE
-		leftWheelSpeed_(0.0f), rightWheelSpeed_(0.0f), timeToOrientation_(simulator_->defaults_->timeToOrientation_), wheelTrack_(simulator_->defaults_->wheelTrack_),
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-		reachedGoal_(false)
-	{
-#if HRVO_DIFFERENTIAL_DRIVE
-		computeWheelSpeeds();
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-	}
+	/**
+	 * \brief  The fraction of the time to the nearest collision after which an agent decides its velocity again.
+	 */
+	const float HRVO_DECISION_TIME_TO_COLLISION_FRACTION = 0.5f;
 
-	Agent::Agent(Simulator *simulator, const Vector2 &position, std::size_t goalNo, float neighborDist, std::size_t maxNeighbors, float radius, const Vector2 &velocity, float maxAccel, float goalRadius, float prefSpeed, float maxSpeed, float orientation,
-#if HRVO_DIFFERENTIAL_DRIVE
-				 float timeToOrientation, float wheelTrack,
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-				 float uncertaintyOffset) : simulator_(simulator), newVelocity_(velocity), position_(position), velocity_(velocity), goalNo_(goalNo), maxNeighbors_(maxNeighbors), goalRadius_(goalRadius), maxAccel_(maxAccel), maxSpeed_(maxSpeed), neighborDist_(neighborDist), orientation_(orientation), prefSpeed_(prefSpeed), radius_(radius), uncertaintyOffset_(uncertaintyOffset),
-#if HRVO_DIFFERENTIAL_DRIVE
-		leftWheelSpeed_(0.0f), rightWheelSpeed_(0.0f), timeToOrientation_(timeToOrientation), wheelTrack_(wheelTrack),
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-		reachedGoal_(false)
-	{
-#if HRVO_DIFFERENTIAL_DRIVE
-		computeWheelSpeeds();
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-	}
+	Agent::Agent(Simulator *simulator) : simulator_(simulator), generation_(0), goalNo_(0), knot_(0), leaf_(0), parametersNo_(0), profileNo_(Simulator::HRVO_NO_AGENT_PROFILE), waypoint_(0), nextDecisionTime_(0.0f), orientation_(0.0f), overrides_(0), leftWheelSpeed_(0.0f), rightWheelSpeed_(0.0f), reachedGoal_(false), removed_(false) { }
 
-	void Agent::computeNeighbors()
+	Agent::Agent(Simulator *simulator, const Vector2 &position, std::size_t goalNo, std::size_t profileNo, std::size_t parametersNo) : simulator_(simulator), newVelocity_((*simulator->parameters_)[parametersNo].velocity_), position_(position), velocity_((*simulator->parameters_)[parametersNo].velocity_), generation_(0), goalNo_(goalNo), knot_(0), leaf_(0), parametersNo_(parametersNo), profileNo_(profileNo), waypoint_(simulator_->goals_[goalNo].begin_), nextDecisionTime_(0.0f), orientation_((*simulator->parameters_)[parametersNo].orientation_), overrides_(0), leftWheelSpeed_(0.0f), rightWheelSpeed_(0.0f), reachedGoal_(false), removed_(false)
 	{
-		neighbors_.clear();
-		simulator_->kdTree_->query(this, neighborDist_ * neighborDist_);
+		if (getParameters().kinematics_ == Simulator::KINEMATICS_DIFFERENTIAL_DRIVE) {
+			computeWheelSpeeds();
+		}
 	}
 
-	void Agent::computeNewVelocity()
+	Agent::Agent(Simulator *simulator, const Agent &other) : simulator_(simulator), newVelocity_(other.newVelocity_), position_(other.position_), prefVelocity_(other.prefVelocity_), velocity_(other.velocity_), generation_(other.generation_), goalNo_(other.goalNo_), knot_(other.knot_), leaf_(0), parametersNo_(other.parametersNo_), profileNo_(other.profileNo_), waypoint_(other.waypoint_), nextDecisionTime_(other.nextDecisionTime_), orientation_(other.orientation_), overrides_(other.overrides_), leftWheelSpeed_(other.leftWheelSpeed_), rightWheelSpeed_(other.rightWheelSpeed_), reachedGoal_(other.reachedGoal_), removed_(other.removed_) { }
+
+	float Agent::computeDecisionInterval(float maxSpeed) const
 	{
-		velocityObstacles_.clear();
-		velocityObstacles_.reserve(neighbors_.size());
+		const AgentParameters &parameters = getParameters();
 
-		VelocityObstacle velocityObstacle;
+		// An agent beyond the neighbor distance, moving at most at the greatest maximum speed, cannot reach this agent sooner.
+		float minTimeToCollision = parameters.maxSpeed_ + maxSpeed > 0.0f ? parameters.neighborDist_ / (parameters.maxSpeed_ + maxSpeed) : std::numeric_limits<float>::infinity();
 
-		for (std::set<std::pair<float, std::size_t > >::const_iterator iter = neighbors_.begin(); iter != neighbors_.end(); ++iter) {
+		for (std::set<std::pair<float, std::size_t> >::const_iterator iter = neighbors_.begin(); iter != neighbors_.end(); ++iter) {
 			const Agent *const other = simulator_->agents_[iter->second];
 
-			if (absSq(other->position_ - position_) > sqr(other->radius_ + radius_)) {
-				const float angle = atan(other->position_ - position_);
-				const float openingAngle = std::asin((other->radius_ + radius_) / abs(other->position_ - position_));
-
-				velocityObstacle.side1_ = Vector2(std::cos(angle - openingAngle), std::sin(angle - openingAngle));
-				velocityObstacle.side2_ = Vector2(std::cos(angle + openingAngle), std::sin(angle + openingAngle));
+			minTimeToCollision = std::min(minTimeToCollision, timeToCollision(other->position_ - position_, newVelocity_ - other->velocity_, parameters.radius_ + other->getParameters().radius_));
+		}
 
-				const float d = 2.0f * std::sin(openingAngle) * std::cos(openingAngle);
+		return std::min(std::max(HRVO_DECISION_TIME_TO_COLLISION_FRACTION * minTimeToCollision, simulator_->minDecisionInterval_), simulator_->maxDecisionInterval_);
+	}
 
-				if (det(other->position_ - position_, prefVelocity_ - other->prefVelocity_) > 0.0f) {
-					const float s = 0.5f * det(velocity_ - other->velocity_, velocityObstacle.side2_) / d;
+	void Agent::computeNeighbors()
+	{
+		const float radius = getParameters().radius_;
 
-					velocityObstacle.apex_ = other->velocity_ + s * velocityObstacle.side1_ - (uncertaintyOffset_ * abs(other->position_ - position_) / (other->radius_ + radius_)) * normalize(other->position_ - position_);
-				}
-				else {
-					const float s = 0.5f * det(velocity_ - other->velocity_, velocityObstacle.side1_) / d;
+		neighbors_.clear();
+		simulator_->kdTree_->query(this, getParameters().neighborDistSq_);
 
-					velocityObstacle.apex_ = other->velocity_ + s * velocityObstacle.side2_ - (uncertaintyOffset_ * abs(other->position_ - position_) / (other->radius_ + radius_)) * normalize(other->position_ - position_);
-				}
+		// An agent that overlaps any of its nearest neighbors avoids only those it overlaps; they are picked once all neighbors are found, so that they do not depend on the order in which agents are visited.
+		std::set<std::pair<float, std::size_t> >::iterator iter = neighbors_.begin();
 
-				velocityObstacles_.push_back(velocityObstacle);
-			}
-			else {
-				velocityObstacle.apex_ = 0.5f * (other->velocity_ + velocity_) - (uncertaintyOffset_ + 0.5f * (other->radius_ + radius_ - abs(other->position_ - position_)) / simulator_->timeStep_) * normalize(other->position_ - position_);
-				velocityObstacle.side1_ = normal(position_, other->position_);
-				velocityObstacle.side2_ = -velocityObstacle.side1_;
-				velocityObstacles_.push_back(velocityObstacle);
-			}
+		while (iter != neighbors_.end() && absSq(position_ - simulator_->agents_[iter->second]->position_) >= sqr(radius + simulator_->agents_[iter->second]->getParameters().radius_)) {
+			++iter;
 		}
 
-		candidates_.clear();
-
-		Candidate candidate;
-
-		candidate.velocityObstacle1_ = std::numeric_limits<int>::max();
-		candidate.velocityObstacle2_ = std::numeric_limits<int>::max();
-
-		if (absSq(prefVelocity_) < maxSpeed_ * maxSpeed_) {
-			candidate.position_ = prefVelocity_;
-		}
-		else {
-			candidate.position_ = maxSpeed_ * normalize(prefVelocity_);
+		if (iter == neighbors_.end()) {
+			return;
 		}
 
-		candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-
-		for (int i = 0; i < static_cast<int>(velocityObstacles_.size()); ++i) {
-			candidate.velocityObstacle1_ = i;
-			candidate.velocityObstacle2_ = i;
-
-			const float dotProduct1 = (prefVelocity_ - velocityObstacles_[i].apex_) * velocityObstacles_[i].side1_;
-			const float dotProduct2 = (prefVelocity_ - velocityObstacles_[i].apex_) * velocityObstacles_[i].side2_;
-
-			if (dotProduct1 > 0.0f && det(velocityObstacles_[i].side1_, prefVelocity_ - velocityObstacles_[i].apex_) > 0.0f) {
-				candidate.position_ = velocityObstacles_[i].apex_ + dotProduct1 * velocityObstacles_[i].side1_;
-
-				if (absSq(candidate.position_) < maxSpeed_ * maxSpeed_) {
-					candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-				}
+		for (iter = neighbors_.begin(); iter != neighbors_.end(); ) {
+			if (absSq(position_ - simulator_->agents_[iter->second]->position_) < sqr(radius + simulator_->agents_[iter->second]->getParameters().radius_)) {
+				++iter;
 			}
-
-			if (dotProduct2 > 0.0f && det(velocityObstacles_[i].side2_, prefVelocity_ - velocityObstacles_[i].apex_) < 0.0f) {
-				candidate.position_ = velocityObstacles_[i].apex_ + dotProduct2 * velocityObstacles_[i].side2_;
-
-				if (absSq(candidate.position_) < maxSpeed_ * maxSpeed_) {
-					candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-				}
+			else {
+				neighbors_.erase(iter++);
 			}
 		}
+	}
 
-		for (int j = 0; j < static_cast<int>(velocityObstacles_.size()); ++j) {
-			candidate.velocityObstacle1_ = std::numeric_limits<int>::max();
-			candidate.velocityObstacle2_ = j;
-
-			float discriminant = maxSpeed_ * maxSpeed_ - sqr(det(velocityObstacles_[j].apex_, velocityObstacles_[j].side1_));
-
-			if (discriminant > 0.0f) {
-
-				const float t1 = -(velocityObstacles_[j].apex_ * velocityObstacles_[j].side1_) + std::sqrt(discriminant);
-				const float t2 = -(velocityObstacles_[j].apex_ * velocityObstacles_[j].side1_) - std::sqrt(discriminant);
-
-				if (t1 >= 0.0f) {
-					candidate.position_ = velocityObstacles_[j].apex_ + t1 * velocityObstacles_[j].side1_;
-					candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-				}
+	void Agent::computeNewVelocity(float timeStep)
+	{
+		const AgentParameters &parameters = getParameters();
 
-				if (t2 >= 0.0f) {
-					candidate.position_ = velocityObstacles_[j].apex_ + t2 * velocityObstacles_[j].side1_;
-					candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-				}
-			}
+		VelocitySolver::Query query;
+		query.position_ = position_;
+		query.prefVelocity_ = prefVelocity_;
+		query.velocity_ = velocity_;
+		query.clusterDist_ = parameters.clusterDist_;
+		query.maxSpeed_ = parameters.maxSpeed_;
+		query.radius_ = parameters.radius_;
+		query.timeHorizon_ = parameters.timeHorizon_;
+		query.timeStep_ = timeStep;
+		query.uncertaintyOffset_ = parameters.uncertaintyOffset_;
 
-			discriminant = maxSpeed_ * maxSpeed_ - sqr(det(velocityObstacles_[j].apex_, velocityObstacles_[j].side2_));
+		neighborDistsSq_.clear();
+		neighborStates_.clear();
 
-			if (discriminant > 0.0f) {
-				const float t1 = -(velocityObstacles_[j].apex_ * velocityObstacles_[j].side2_) + std::sqrt(discriminant);
-				const float t2 = -(velocityObstacles_[j].apex_ * velocityObstacles_[j].side2_) - std::sqrt(discriminant);
+		VelocitySolver::Neighbor neighbor;
 
-				if (t1 >= 0.0f) {
-					candidate.position_ = velocityObstacles_[j].apex_ + t1 * velocityObstacles_[j].side2_;
-					candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-				}
+		for (std::set<std::pair<float, std::size_t> >::const_iterator iter = neighbors_.begin(); iter != neighbors_.end(); ++iter) {
+			const Agent *const other = simulator_->agents_[iter->second];
 
-				if (t2 >= 0.0f) {
-					candidate.position_ = velocityObstacles_[j].apex_ + t2 * velocityObstacles_[j].side2_;
-					candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-				}
-			}
+			neighbor.position_ = other->position_;
+			neighbor.prefVelocity_ = other->prefVelocity_;
+			neighbor.velocity_ = other->velocity_;
+			neighbor.radius_ = other->getParameters().radius_;
+			neighborStates_.push_back(neighbor);
+			neighborDistsSq_.push_back(iter->first);
 		}
 
-		for (int i = 0; i < static_cast<int>(velocityObstacles_.size()) - 1; ++i) {
-			for (int j = i + 1; j < static_cast<int>(velocityObstacles_.size()); ++j) {
-				candidate.velocityObstacle1_ = i;
-				candidate.velocityObstacle2_ = j;
-
-				float d = det(velocityObstacles_[i].side1_, velocityObstacles_[j].side1_);
-
-				if (d != 0.0f) {
-					const float s = det(velocityObstacles_[j].apex_ - velocityObstacles_[i].apex_, velocityObstacles_[j].side1_) / d;
-					const float t = det(velocityObstacles_[j].apex_ - velocityObstacles_[i].apex_, velocityObstacles_[i].side1_) / d;
-
-					if (s >= 0.0f && t >= 0.0f) {
-						candidate.position_ = velocityObstacles_[i].apex_ + s * velocityObstacles_[i].side1_;
-
-						if (absSq(candidate.position_) < maxSpeed_ * maxSpeed_) {
-							candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-						}
-					}
-				}
-
-				d = det(velocityObstacles_[i].side2_, velocityObstacles_[j].side1_);
-
-				if (d != 0.0f) {
-					const float s = det(velocityObstacles_[j].apex_ - velocityObstacles_[i].apex_, velocityObstacles_[j].side1_) / d;
-					const float t = det(velocityObstacles_[j].apex_ - velocityObstacles_[i].apex_, velocityObstacles_[i].side2_) / d;
-
-					if (s >= 0.0f && t >= 0.0f) {
-						candidate.position_ = velocityObstacles_[i].apex_ + s * velocityObstacles_[i].side2_;
-
-						if (absSq(candidate.position_) < maxSpeed_ * maxSpeed_) {
-							candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-						}
-					}
-				}
-
-				d = det(velocityObstacles_[i].side1_, velocityObstacles_[j].side2_);
-
-				if (d != 0.0f) {
-					const float s = det(velocityObstacles_[j].apex_ - velocityObstacles_[i].apex_, velocityObstacles_[j].side2_) / d;
-					const float t = det(velocityObstacles_[j].apex_ - velocityObstacles_[i].apex_, velocityObstacles_[i].side1_) / d;
-
-					if (s >= 0.0f && t >= 0.0f) {
-						candidate.position_ = velocityObstacles_[i].apex_ + s * velocityObstacles_[i].side1_;
-
-						if (absSq(candidate.position_) < maxSpeed_ * maxSpeed_) {
-							candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-						}
-					}
-				}
-
-				d = det(velocityObstacles_[i].side2_, velocityObstacles_[j].side2_);
-
-				if (d != 0.0f) {
-					const float s = det(velocityObstacles_[j].apex_ - velocityObstacles_[i].apex_, velocityObstacles_[j].side2_) / d;
-					const float t = det(velocityObstacles_[j].apex_ - velocityObstacles_[i].apex_, velocityObstacles_[i].side2_) / d;
+		newVelocity_ = solver_.solve(query, neighborStates_.data(), neighborDistsSq_.data(), neighborStates_.size());
+	}
 
-					if (s >= 0.0f && t >= 0.0f) {
-						candidate.position_ = velocityObstacles_[i].apex_ + s * velocityObstacles_[i].side2_;
+	void Agent::computePreferredVelocity()
+	{
+		const AgentParameters &parameters = getParameters();
+		const float prefSpeed = parameters.prefSpeed_;
+		const float maxAccel = parameters.maxAccel_;
 
-						if (absSq(candidate.position_) < maxSpeed_ * maxSpeed_) {
-							candidates_.insert(std::make_pair(absSq(prefVelocity_ - candidate.position_), candidate));
-						}
-					}
-				}
-			}
+		if(prefSpeed <= 0.1f || maxAccel <= 0.1f || removed_)
+		{
+			prefVelocity_ = Vector2(0.f, 0.f);
+			return;
 		}
 
-		int optimal = -1;
-
-		for (std::multimap<float, Candidate>::const_iterator iter = candidates_.begin(); iter != candidates_.end(); ++iter) {
-			candidate = iter->second;
-			bool valid = true;
+		const Trajectory *const trajectory = simulator_->goals_[goalNo_].trajectory_.get();
 
-			for (int j = 0; j < static_cast<int>(velocityObstacles_.size()); ++j) {
-				if (j != candidate.velocityObstacle1_ && j != candidate.velocityObstacle2_ && det(velocityObstacles_[j].side2_, candidate.position_ - velocityObstacles_[j].apex_) < 0.0f && det(velocityObstacles_[j].side1_, candidate.position_ - velocityObstacles_[j].apex_) > 0.0f) {
-					valid = false;
+		// A trajectory is tracked by its velocity, fed forward, corrected towards its position, both at the end of the step over which the velocity applies.
+		if (trajectory != NULL) {
+			Vector2 referencePosition;
+			Vector2 referenceVelocity;
+			trajectory->evaluate(simulator_->globalTime_ + simulator_->timeStep_, knot_, referencePosition, referenceVelocity);
 
-					if (j > optimal) {
-						optimal = j;
-						newVelocity_ = candidate.position_;
-					}
-
-					break;
-				}
-			}
+			prefVelocity_ = referenceVelocity + (referencePosition - position_) / trajectory->trackingTime_;
 
-			if (valid) {
-				newVelocity_ = candidate.position_;
-				break;
+			if (absSq(prefVelocity_) > parameters.maxSpeedSq_) {
+				prefVelocity_ = normalize(prefVelocity_) * parameters.maxSpeed_;
 			}
-		}
-	}
 
-	void Agent::computePreferredVelocity()
-	{
-		if(prefSpeed_ <= 0.1f || maxAccel_ <= 0.1f)
-		{
-			prefVelocity_ = Vector2(0.f, 0.f);
 			return;
 		}
 
-		const Vector2 goalPosition = simulator_->goals_[goalNo_]->getCurrentGoalPosition();
+		const Vector2 goalPosition = (*simulator_->waypoints_)[waypoint_];
 		const Vector2 distVectorToGoal = goalPosition - position_;
-		const float distToGoal = sqrt(sqr(distVectorToGoal.getX()) + sqr(distVectorToGoal.getY()));
+		Vector2 directionToGoal;
+		float distToGoal;
+
+		// Around static obstacles, the agent follows the shortest path on the navigation grid rather than the straight line to its goal.
+		if (simulator_->navigationGrid_ == NULL || !simulator_->navigationGrid_->getFlow(goalPosition, position_, directionToGoal, distToGoal)) {
+			directionToGoal = normalize(distVectorToGoal);
+			distToGoal = sqrt(sqr(distVectorToGoal.getX()) + sqr(distVectorToGoal.getY()));
+		}
 		// d = - Vi^2 / 2a   if Vf = 0
-		const float startLinearDecelerationDistance = sqr(prefSpeed_) / (2*maxAccel_);
-		const float startLinearDecelerationTime = prefSpeed_ / maxAccel_;
+		const float startLinearDecelerationDistance = sqr(prefSpeed) / (2*maxAccel);
+		const float startLinearDecelerationTime = prefSpeed / maxAccel;
 
-		prefVelocity_ = normalize(distVectorToGoal) * prefSpeed_;
+		prefVelocity_ = directionToGoal * prefSpeed;
 		if (distToGoal < startLinearDecelerationDistance)
 		{
 			// the slope of the velocity graph reaching the destination is -maxAccel
@@ -326,7 +196,7 @@ namespace hrvo {
 		}
 		else
 		{
-			prefVelocity_ = normalize(goalPosition - position_) * prefSpeed_;
+			prefVelocity_ = directionToGoal * prefSpeed;
 			// prefVelocity_ = (goalPosition - position_) / simulator_->timeStep_;
 		}
 
@@ -351,57 +221,100 @@ namespace hrvo {
 		// }
 	}
 
-#if HRVO_DIFFERENTIAL_DRIVE
+	std::size_t Agent::computeQuiescentSteps(std::size_t maxSteps, float maxSpeed, float maxNeighborDist) const
+	{
+		const float speed = abs(velocity_);
+
+		// Parked agents are held in place; any moving agent that could interact with them is not quiescent.
+		if (isParked()) {
+			return maxSteps;
+		}
+
+		// Agents following a flow field turn at cell boundaries, and agents tracking a trajectory follow its curve, so their preferred velocities do not stay constant.
+		if (speed <= HRVO_EPSILON || absSq(velocity_ - prefVelocity_) > sqr(HRVO_EPSILON) || simulator_->navigationGrid_ != NULL || simulator_->goals_[goalNo_].trajectory_ != NULL) {
+			return 0;
+		}
+
+		// The preferred velocity stays constant until the agent enters the deceleration distance or the radius of its goal.
+		const float distToGoal = abs((*simulator_->waypoints_)[waypoint_] - position_);
+		const AgentParameters &parameters = getParameters();
+		const float decelerationDist = parameters.maxAccel_ > 0.0f ? sqr(parameters.prefSpeed_) / (2.0f * parameters.maxAccel_) : 0.0f;
+		float time = std::min(static_cast<float>(maxSteps) * simulator_->timeStep_, (distToGoal - std::max(decelerationDist, parameters.goalRadius_)) / speed);
+
+		// Another agent cannot come within any neighbor distance sooner than the gap closes at the sum of their speeds.
+		const float closingSpeed = speed + maxSpeed;
+		const float nearestDist = std::sqrt(simulator_->kdTree_->queryNearest(this, sqr(maxNeighborDist + closingSpeed * std::max(time, 0.0f))));
+		time = std::min(time, (nearestDist - maxNeighborDist) / closingSpeed);
+
+		if (time <= 0.0f) {
+			return 0;
+		}
+
+		return std::min(maxSteps, static_cast<std::size_t>(time / simulator_->timeStep_));
+	}
+
+	float Agent::computeTimeToOverlap(float tolerance) const
+	{
+		const float radius = getParameters().radius_;
+		float minTimeToOverlap = std::numeric_limits<float>::infinity();
+
+		for (std::set<std::pair<float, std::size_t> >::const_iterator iter = neighbors_.begin(); iter != neighbors_.end(); ++iter) {
+			const Agent *const other = simulator_->agents_[iter->second];
+			const float combinedRadius = radius + other->getParameters().radius_ - tolerance;
+
+			// Pairs that already overlap by more than the tolerance are left to the velocity obstacles to push apart.
+			if (combinedRadius > 0.0f && absSq(other->position_ - position_) > sqr(combinedRadius)) {
+				minTimeToOverlap = std::min(minTimeToOverlap, timeToCollision(other->position_ - position_, newVelocity_ - other->newVelocity_, combinedRadius));
+			}
+		}
+
+		return minTimeToOverlap;
+	}
+
 	void Agent::computeWheelSpeeds()
 	{
+		const AgentParameters &parameters = getParameters();
+		const float maxSpeed = parameters.maxSpeed_;
 		float targetOrientation;
 
 		if (reachedGoal_) {
 			targetOrientation = orientation_;
 		}
 		else {
-			targetOrientation = atan(newVelocity_);
+			targetOrientation = fastAtan(newVelocity_);
 		}
 
-		float orientationDiff = std::fmod(targetOrientation - orientation_, 2.0f * HRVO_PI);
+		const float orientationDiff = fastWrapAngle(targetOrientation - orientation_);
 
-		if (orientationDiff < -HRVO_PI) {
-			orientationDiff += 2.0f * HRVO_PI;
-		}
-
-		if (orientationDiff > HRVO_PI) {
-			orientationDiff -= 2.0f * HRVO_PI;
-		}
-
-		float speedDiff = (orientationDiff * wheelTrack_) / timeToOrientation_;
+		float speedDiff = (orientationDiff * parameters.wheelTrack_) / parameters.timeToOrientation_;
 
-		if (speedDiff > 2.0f * maxSpeed_) {
-			speedDiff = 2.0f * maxSpeed_;
+		if (speedDiff > 2.0f * maxSpeed) {
+			speedDiff = 2.0f * maxSpeed;
 		}
-		else if (speedDiff < -2.0f * maxSpeed_) {
-			speedDiff = -2.0f * maxSpeed_;
+		else if (speedDiff < -2.0f * maxSpeed) {
+			speedDiff = -2.0f * maxSpeed;
 		}
 
 		float targetSpeed = abs(newVelocity_);
 
-		if (targetSpeed + 0.5f * std::fabs(speedDiff) > maxSpeed_) {
+		if (targetSpeed + 0.5f * std::fabs(speedDiff) > maxSpeed) {
 			if (speedDiff >= 0.0f) {
-				rightWheelSpeed_ = maxSpeed_;
-				leftWheelSpeed_ = maxSpeed_ - speedDiff;
+				rightWheelSpeed_ = maxSpeed;
+				leftWheelSpeed_ = maxSpeed - speedDiff;
 			}
 			else {
-				leftWheelSpeed_ = maxSpeed_;
-				rightWheelSpeed_ = maxSpeed_ + speedDiff;
+				leftWheelSpeed_ = maxSpeed;
+				rightWheelSpeed_ = maxSpeed + speedDiff;
 			}
 		}
-		else if (targetSpeed - 0.5f * std::fabs(speedDiff) < -maxSpeed_) {
+		else if (targetSpeed - 0.5f * std::fabs(speedDiff) < -maxSpeed) {
 			if (speedDiff >= 0.0f) {
-				leftWheelSpeed_ = -maxSpeed_;
-				rightWheelSpeed_ = speedDiff - maxSpeed_;
+				leftWheelSpeed_ = -maxSpeed;
+				rightWheelSpeed_ = speedDiff - maxSpeed;
 			}
 			else {
-				rightWheelSpeed_ = -maxSpeed_;
-				leftWheelSpeed_ = -maxSpeed_ - speedDiff;
+				rightWheelSpeed_ = -maxSpeed;
+				leftWheelSpeed_ = -maxSpeed - speedDiff;
 			}
 		}
 		else {
@@ -409,96 +322,119 @@ namespace hrvo {
 			leftWheelSpeed_ = targetSpeed - 0.5f * speedDiff;
 		}
 	}
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
 
-	void Agent::insertNeighbor(std::size_t agentNo, float &rangeSq)
+	bool Agent::hasOverlappingNeighbor() const
 	{
-		const Agent *const other = simulator_->agents_[agentNo];
+		const float radius = getParameters().radius_;
+
+		for (std::set<std::pair<float, std::size_t> >::const_iterator iter = neighbors_.begin(); iter != neighbors_.end(); ++iter) {
+			const Agent *const other = simulator_->agents_[iter->second];
 
-		if (this != other) {
-			const float distSq = absSq(position_ - other->position_);
+			if (absSq(other->position_ - position_) < sqr(radius + other->getParameters().radius_)) {
+				return true;
+			}
+		}
 
-			if (distSq < sqr(radius_ + other->radius_) && distSq < rangeSq) {
-				neighbors_.clear();
+		return false;
+	}
 
-				if (neighbors_.size() == maxNeighbors_) {
-					neighbors_.erase(--neighbors_.end());
-				}
+	void Agent::fastForward(float time)
+	{
+		if (isParked()) {
+			newVelocity_ = Vector2();
+			velocity_ = Vector2();
+			leftWheelSpeed_ = 0.0f;
+			rightWheelSpeed_ = 0.0f;
+		}
+		else {
+			position_ += time * velocity_;
+		}
+	}
 
-				neighbors_.insert(std::make_pair(distSq, agentNo));
+	void Agent::insertNeighbor(std::size_t agentNo, float distSq, float &rangeSq)
+	{
+		const Agent *const other = simulator_->agents_[agentNo];
+		const std::size_t maxNeighbors = getParameters().maxNeighbors_;
 
-				if (neighbors_.size() == maxNeighbors_) {
-					rangeSq = (--neighbors_.end())->first;
-				}
+		// Once the set of neighbors is full, ties in distance are broken by agent number so that the neighbors do not depend on the order in which agents are visited.
+		if (this != other && !other->removed_ && (distSq < rangeSq || (distSq == rangeSq && !neighbors_.empty() && neighbors_.size() == maxNeighbors && agentNo < (--neighbors_.end())->second))) {
+			if (neighbors_.size() == maxNeighbors) {
+				neighbors_.erase(--neighbors_.end());
 			}
-			else if (distSq < rangeSq) {
-				if (neighbors_.size() == maxNeighbors_) {
-					neighbors_.erase(--neighbors_.end());
-				}
 
-				neighbors_.insert(std::make_pair(distSq, agentNo));
+			neighbors_.insert(std::make_pair(distSq, agentNo));
 
-				if (neighbors_.size() == maxNeighbors_) {
-					rangeSq = (--neighbors_.end())->first;
-				}
+			if (neighbors_.size() == maxNeighbors) {
+				rangeSq = (--neighbors_.end())->first;
 			}
 		}
 	}
 
-	void Agent::update()
+	bool Agent::isDecisionDue() const
+	{
+		// Decisions fall on the nearest step, whatever the rounding of the global time.
+		return nextDecisionTime_ <= simulator_->globalTime_ + 0.5f * simulator_->timeStep_;
+	}
+
+	bool Agent::isParked() const
+	{
+		// A parked agent would come to rest within a single step of deceleration.
+		return reachedGoal_ && absSq(velocity_) <= sqr(getParameters().maxAccel_ * simulator_->timeStep_);
+	}
+
+	void Agent::updateDifferentialDrive(float timeStep)
 	{
-#if HRVO_DIFFERENTIAL_DRIVE
 		const float averageWheelSpeed = 0.5f * (rightWheelSpeed_ + leftWheelSpeed_);
 		const float wheelSpeedDifference = rightWheelSpeed_ - leftWheelSpeed_;
 
-		position_ += simulator_->timeStep_ * averageWheelSpeed * Vector2(std::cos(orientation_), std::sin(orientation_));
-		orientation_ += wheelSpeedDifference * simulator_->timeStep_ / wheelTrack_;
-		velocity_ = averageWheelSpeed * Vector2(std::cos(orientation_), std::sin(orientation_));
-#else /* HRVO_DIFFERENTIAL_DRIVE */
+		float sine;
+		float cosine;
 
+		fastSinCos(orientation_, sine, cosine);
+		position_ += timeStep * averageWheelSpeed * Vector2(cosine, sine);
+		orientation_ += wheelSpeedDifference * timeStep / getParameters().wheelTrack_;
+
+		fastSinCos(orientation_, sine, cosine);
+		velocity_ = averageWheelSpeed * Vector2(cosine, sine);
+	}
+
+	void Agent::updateHolonomic(float timeStep)
+	{
+		// The fraction of the change in velocity reached in this step; a change within the limit is reached in full.
 		const float dv = abs(newVelocity_ - velocity_);
+		const float fraction = std::min(1.0f, getParameters().maxAccel_ * timeStep / dv);
 
-		if (dv < maxAccel_ * simulator_->timeStep_) {
-			velocity_ = newVelocity_;
-		}
-		else {
-//			Vector2 oldVel = velocity_;
-			velocity_ = (1.0f - (maxAccel_ * simulator_->timeStep_ / dv)) * velocity_ + (maxAccel_ * simulator_->timeStep_ / dv) * newVelocity_;
-//			Vector2 dvVec = velocity_ - oldVel;
-			
-//			const Vector2 goalPosition = simulator_->goals_[goalNo_]->position_;
-//			const Vector2 distVectorToGoal = goalPosition - position_;
-//			const float distToGoal = sqrt(sqr(distVectorToGoal.getX()) + sqr(distVectorToGoal.getY()));
-//			std::cout << "distToGoal=" << distToGoal << " dv=" << dv <<  " Actualdv=" << abs(dvVec) << " newVelocity_=" << velocity_ << " maxAccel/frame=" << maxAccel_  * simulator_->timeStep_ << std::endl;
-		}
+		velocity_ = (1.0f - fraction) * velocity_ + fraction * newVelocity_;
+		position_ += velocity_ * timeStep;
+	}
 
-		position_ += velocity_ * simulator_->timeStep_;
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-
-		if (absSq(simulator_->goals_[goalNo_]->getCurrentGoalPosition() - position_) < goalRadius_ * goalRadius_) {
-            // Is at current goal position
-            if (simulator_->goals_[goalNo_]->isGoingToFinalGoal())
-            {
-                reachedGoal_ = true;
-            }
-            else
-            {
-                simulator_->goals_[goalNo_]->getNextGoalPostion();
-                reachedGoal_ = false;
-                simulator_->reachedGoals_ = false;
-            }
-		}
-		else {
-			reachedGoal_ = false;
-			simulator_->reachedGoals_ = false;
-		}
+	void Agent::updateOmnidirectional(float timeStep)
+	{
+		const float maxDv = getParameters().maxAccel_ * timeStep;
+		const Vector2 dv = newVelocity_ - velocity_;
 
-#if !HRVO_DIFFERENTIAL_DRIVE
+		velocity_ += Vector2(std::max(-maxDv, std::min(maxDv, dv.getX())), std::max(-maxDv, std::min(maxDv, dv.getY())));
+		position_ += velocity_ * timeStep;
+	}
 
-		if (!reachedGoal_) {
-			orientation_ = atan(prefVelocity_);
+	void Agent::updateGoal()
+	{
+		// A removed agent stays at rest at its last position until its number is reused.
+		if (removed_) {
+			return;
 		}
 
-#endif /* !HRVO_DIFFERENTIAL_DRIVE */
+		// The goal is reached at its last waypoint; any other waypoint that is reached is passed.
+		const bool atWaypoint = absSq((*simulator_->waypoints_)[waypoint_] - position_) < getParameters().goalRadiusSq_;
+		const bool atLastWaypoint = waypoint_ + 1 == simulator_->goals_[goalNo_].end_;
+		const Trajectory *const trajectory = simulator_->goals_[goalNo_].trajectory_.get();
+
+		// The goal of a trajectory is reached only once the trajectory has ended.
+		reachedGoal_ = atWaypoint && atLastWaypoint && (trajectory == NULL || simulator_->globalTime_ >= trajectory->getEndTime());
+		waypoint_ += static_cast<std::size_t>(atWaypoint && !atLastWaypoint);
+
+		if (getParameters().kinematics_ != Simulator::KINEMATICS_DIFFERENTIAL_DRIVE && !reachedGoal_) {
+			orientation_ = fastAtan(prefVelocity_);
+		}
 	}
 }
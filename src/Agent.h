@@ -39,15 +39,16 @@
 #define HRVO_AGENT_H_
 
 #include <cstddef>
-#include <map>
 #include <set>
 #include <utility>
 #include <vector>
 #include <Goal.h>
 
 
+#include "AgentParameters.h"
 #include "Simulator.h"
 #include "Vector2.h"
+#include "VelocitySolver.h"
 
 namespace hrvo {
 	/**
@@ -56,59 +57,6 @@ namespace hrvo {
 	 */
 	class Agent {
 	private:
-		/**
-		 * \class  Candidate
-		 * \brief  A candidate point.
-		 */
-		class Candidate {
-		public:
-			/**
-			 * \brief  Constructor.
-			 */
-			Candidate() : velocityObstacle1_(0), velocityObstacle2_(0) { }
-
-			/**
-			 * \brief  The position of the candidate point.
-			 */
-			Vector2 position_;
-
-			/**
-			 * \brief  The number of the first velocity obstacle.
-			 */
-			int velocityObstacle1_;
-
-			/**
-			 * \brief  The number of the second velocity obstacle.
-			 */
-			int velocityObstacle2_;
-		};
-
-		/**
-		 * \class  VelocityObstacle
-		 * \brief  A hybrid reciprocal velocity obstacle.
-		 */
-		class VelocityObstacle {
-		public:
-			/**
-			 * \brief  Constructor.
-			 */
-			VelocityObstacle() { }
-			/**
-			 * \brief  The position of the apex of the hybrid reciprocal velocity obstacle.
-			 */
-			Vector2 apex_;
-
-			/**
-			 * \brief  The direction of the first side of the hybrid reciprocal velocity obstacle.
-			 */
-			Vector2 side1_;
-
-			/**
-			 * \brief  The direction of the second side of the hybrid reciprocal velocity obstacle.
-			 */
-			Vector2 side2_;
-		};
-
 		/**
 		 * \brief      Constructor.
 		 * \param[in]  simulator  The simulation.
@@ -117,33 +65,27 @@ namespace hrvo {
 
 		/**
 		 * \brief      Constructor.
+		 * \param[in]  simulator     The simulation.
+		 * \param[in]  position      The starting position of this agent.
+		 * \param[in]  goalNo        The goal number of this agent.
+		 * \param[in]  profileNo     The number of the agent profile of this agent, or HRVO_NO_AGENT_PROFILE if it has none.
+		 * \param[in]  parametersNo  The number of the parameters of this agent, from which it also takes its initial velocity and orientation.
+		 */
+		Agent(Simulator *simulator, const Vector2 &position, std::size_t goalNo, std::size_t profileNo, std::size_t parametersNo);
+
+		/**
+		 * \brief      Constructor that copies the state and properties, but not the neighbors, of another agent.
 		 * \param[in]  simulator  The simulation.
-		 * \param[in]  position   The starting position of this agent.
-		 * \param[in]  goalNo     The goal number of this agent.
+		 * \param[in]  other      The agent to copy.
 		 */
-		Agent(Simulator *simulator, const Vector2 &position, std::size_t goalNo);
+		Agent(Simulator *simulator, const Agent &other);
 
 		/**
-		 * \brief      Constructor.
-		 * \param[in]  simulator          The simulation.
-		 * \param[in]  position           The starting position of this agent.
-		 * \param[in]  goalNo             The goal number of this agent.
-		 * \param[in]  neighborDist       The maximum neighbor distance of this agent.
-		 * \param[in]  maxNeighbors       The maximum neighbor count of this agent.
-		 * \param[in]  radius             The radius of this agent.
-		 * \param[in]  goalRadius         The goal radius of this agent.
-		 * \param[in]  prefSpeed          The preferred speed of this agent.
-		 * \param[in]  maxSpeed           The maximum speed of this agent.
-		 * \param[in]  uncertaintyOffset  The uncertainty offset of this agent.
-		 * \param[in]  maxAccel           The maximum acceleration of this agent.
-		 * \param[in]  velocity           The initial velocity of this agent.
-		 * \param[in]  orientation        The initial orientation (in radians) of this agent.
-		 */
-		Agent(Simulator *simulator, const Vector2 &position, std::size_t goalNo, float neighborDist, std::size_t maxNeighbors, float radius, const Vector2 &velocity, float maxAccel, float goalRadius, float prefSpeed, float maxSpeed, float orientation,
-#if HRVO_DIFFERENTIAL_DRIVE
-			float timeToOrientation, float wheelTrack,
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-			float uncertaintyOffset);
+		 * \brief      Computes the time after which this agent decides its velocity again from the time to its nearest collision at its new velocity.
+		 * \param[in]  maxSpeed  The greatest maximum speed of any agent, which bounds how soon an agent beyond the neighbor distance may arrive.
+		 * \return     The decision interval of this agent, clamped to the bounds of the simulation.
+		 */
+		float computeDecisionInterval(float maxSpeed) const;
 
 		/**
 		 * \brief  Computes the neighbors of this agent.
@@ -151,33 +93,97 @@ namespace hrvo {
 		void computeNeighbors();
 
 		/**
-		 * \brief  Computes the new velocity of this agent.
+		 * \brief      Computes the new velocity of this agent.
+		 * \param[in]  timeStep  The time over which the new velocity is applied, within which the agent separates from any neighbor it overlaps.
 		 */
-		void computeNewVelocity();
+		void computeNewVelocity(float timeStep);
 
 		/**
 		 * \brief  Computes the preferred velocity of this agent.
 		 */
 		void computePreferredVelocity();
 
-#if HRVO_DIFFERENTIAL_DRIVE
 		/**
-		 * \brief  Computes the wheel speeds of this agent.
+		 * \brief      Computes the number of steps for which this agent remains quiescent, either parked at its final goal or moving at its preferred velocity beyond the neighbor distance of any other agent and without nearing its goal.
+		 * \param[in]  maxSteps         The maximum number of steps.
+		 * \param[in]  maxSpeed         The maximum speed of any agent.
+		 * \param[in]  maxNeighborDist  The maximum neighbor distance of any agent.
+		 * \return     The number of steps, up to the maximum, for which this agent remains quiescent.
+		 */
+		std::size_t computeQuiescentSteps(std::size_t maxSteps, float maxSpeed, float maxNeighborDist) const;
+
+		/**
+		 * \brief      Computes the time until this agent first overlaps a neighbor by more than a tolerance if both move at their new velocities.
+		 * \param[in]  tolerance  The overlap tolerance.
+		 * \return     The time until the first overlap, or infinity if there is none.
+		 */
+		float computeTimeToOverlap(float tolerance) const;
+
+		/**
+		 * \brief  Computes the wheel speeds of this agent, which is a differential-drive agent.
 		 */
 		void computeWheelSpeeds();
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
+
+		/**
+		 * \brief   Returns the parameters of this agent, which it may share with other agents.
+		 * \return  The parameters of this agent.
+		 */
+		const AgentParameters &getParameters() const { return (*simulator_->parameters_)[parametersNo_]; }
+
+		/**
+		 * \brief   Returns whether this agent overlaps any of its neighbors.
+		 * \return  True if this agent overlaps a neighbor; false otherwise.
+		 */
+		bool hasOverlappingNeighbor() const;
+
+		/**
+		 * \brief      Advances this agent over a quiescent interval; a parked agent comes to rest in place, and any other agent moves at its velocity.
+		 * \param[in]  time  The duration of the interval.
+		 */
+		void fastForward(float time);
 
 		/**
 		 * \brief          Inserts a neighbor into the set of neighbors of this agent.
 		 * \param[in]      agentNo  The number of the agent to be inserted.
+		 * \param[in]      distSq   The squared distance, between centers or between surfaces, from this agent to the agent to be inserted.
 		 * \param[in,out]  rangeSq  The squared range around this agent.
 		 */
-		void insertNeighbor(std::size_t agentNo, float &rangeSq);
+		void insertNeighbor(std::size_t agentNo, float distSq, float &rangeSq);
+
+		/**
+		 * \brief   Returns whether this agent decides its velocity at the present step.
+		 * \return  True if the decision of this agent is due; false otherwise.
+		 */
+		bool isDecisionDue() const;
+
+		/**
+		 * \brief   Returns whether this agent is parked at its goal, slow enough to come to rest within a single step.
+		 * \return  True if this agent is parked; false otherwise.
+		 */
+		bool isParked() const;
+
+		/**
+		 * \brief      Updates the orientation, position, and velocity of this agent, which is a differential-drive agent, from its wheel speeds.
+		 * \param[in]  timeStep  The time step over which this agent moves.
+		 */
+		void updateDifferentialDrive(float timeStep);
+
+		/**
+		 * \brief      Updates the position and velocity of this agent, which is a holonomic agent, with the change in velocity limited in magnitude by the maximum acceleration.
+		 * \param[in]  timeStep  The time step over which this agent moves.
+		 */
+		void updateHolonomic(float timeStep);
+
+		/**
+		 * \brief      Updates the position and velocity of this agent, which is an omnidirectional agent, with the change in velocity limited along each axis by the maximum acceleration.
+		 * \param[in]  timeStep  The time step over which this agent moves.
+		 */
+		void updateOmnidirectional(float timeStep);
 
 		/**
-		 * \brief  Updates the orientation, position, and velocity of this agent.
+		 * \brief  Updates the progress along the waypoints of its goal, and unless it is a differential-drive agent the orientation, of this agent.
 		 */
-		void update();
+		void updateGoal();
 
     public: // A
 		Simulator *const simulator_;
@@ -185,26 +191,24 @@ namespace hrvo {
 		Vector2 position_;
 		Vector2 prefVelocity_;
 		Vector2 velocity_;
+		std::size_t generation_;
 		std::size_t goalNo_;
-		std::size_t maxNeighbors_;
-		float goalRadius_;
-		float maxAccel_;
-		float maxSpeed_;
-		float neighborDist_;
+		std::size_t knot_;
+		std::size_t leaf_;
+		std::size_t parametersNo_;
+		std::size_t profileNo_;
+		std::size_t waypoint_;
+		float nextDecisionTime_;
 		float orientation_;
-		float prefSpeed_;
-		float radius_;
-		float uncertaintyOffset_;
-#if HRVO_DIFFERENTIAL_DRIVE
+		unsigned int overrides_;
 		float leftWheelSpeed_;
 		float rightWheelSpeed_;
-		float timeToOrientation_;
-		float wheelTrack_;
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
 		bool reachedGoal_;
-		std::multimap<float, Candidate> candidates_;
+		bool removed_;
+		std::vector<float> neighborDistsSq_;
 		std::set<std::pair<float, std::size_t> > neighbors_;
-		std::vector<VelocityObstacle> velocityObstacles_;
+		std::vector<VelocitySolver::Neighbor> neighborStates_;
+		VelocitySolver solver_;
 
 		friend class KdTree;
 		friend class Simulator;
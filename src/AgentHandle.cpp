@@ -0,0 +1,46 @@
+/*
+ * AgentHandle.cpp
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   AgentHandle.cpp
+ * \brief  Defines the AgentHandle class.
+ */
+
+#include "AgentHandle.h"
+
+#include <limits>
+
+namespace hrvo {
+	AgentHandle::AgentHandle() : agentNo_(std::numeric_limits<std::size_t>::max()), generation_(0) { }
+
+	AgentHandle::AgentHandle(std::size_t agentNo, std::size_t generation) : agentNo_(agentNo), generation_(generation) { }
+}
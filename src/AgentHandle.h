@@ -0,0 +1,102 @@
+/*
+ * AgentHandle.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   AgentHandle.h
+ * \brief  Declares the AgentHandle class.
+ */
+
+#ifndef HRVO_AGENT_HANDLE_H_
+#define HRVO_AGENT_HANDLE_H_
+
+#include <cstddef>
+
+#include "Export.h"
+
+namespace hrvo {
+	/**
+	 * \class    AgentHandle
+	 * \brief    Identifies an agent for as long as it remains in the simulation.
+	 *
+	 * \details  The number of a removed agent is reused by the next agent
+	 *           added, but the generation of the number is advanced, so that
+	 *           a handle to the removed agent does not identify its successor.
+	 */
+	class HRVO_EXPORT AgentHandle {
+	public:
+		/**
+		 * \brief  Constructor of a handle that identifies no agent.
+		 */
+		AgentHandle();
+
+		/**
+		 * \brief   Returns the number of the agent.
+		 * \return  The number of the agent.
+		 */
+		std::size_t getAgentNo() const { return agentNo_; }
+
+		/**
+		 * \brief   Returns the generation of the number of the agent.
+		 * \return  The count of agents removed from the number before the agent was added.
+		 */
+		std::size_t getGeneration() const { return generation_; }
+
+		/**
+		 * \brief      Tests whether this handle identifies the same agent as another.
+		 * \param[in]  other  The other handle.
+		 * \return     True if the handles are equal; false otherwise.
+		 */
+		bool operator==(const AgentHandle &other) const { return agentNo_ == other.agentNo_ && generation_ == other.generation_; }
+
+		/**
+		 * \brief      Tests whether this handle identifies a different agent than another.
+		 * \param[in]  other  The other handle.
+		 * \return     True if the handles are not equal; false otherwise.
+		 */
+		bool operator!=(const AgentHandle &other) const { return !(*this == other); }
+
+	private:
+		/**
+		 * \brief      Constructor.
+		 * \param[in]  agentNo     The number of the agent.
+		 * \param[in]  generation  The generation of the number of the agent.
+		 */
+		AgentHandle(std::size_t agentNo, std::size_t generation);
+
+		std::size_t agentNo_;
+		std::size_t generation_;
+
+		friend class Simulator;
+	};
+}
+
+#endif /* HRVO_AGENT_HANDLE_H_ */
@@ -0,0 +1,113 @@
+/*
+ * AgentParameters.cpp
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   AgentParameters.cpp
+ * \brief  Defines the AgentParameters class.
+ */
+
+#include "AgentParameters.h"
+
+#include <limits>
+
+namespace hrvo {
+	AgentParameters::AgentParameters() : maxNeighbors_(0), clusterDist_(std::numeric_limits<float>::infinity()), goalRadius_(0.0f), goalRadiusSq_(0.0f), maxAccel_(0.0f), maxSpeed_(0.0f), maxSpeedSq_(0.0f), neighborDist_(0.0f), neighborDistSq_(0.0f), orientation_(0.0f), prefSpeed_(0.0f), radius_(0.0f), timeHorizon_(std::numeric_limits<float>::infinity()), timeToOrientation_(0.0f), uncertaintyOffset_(0.0f), wheelTrack_(0.0f), kinematics_(Simulator::KINEMATICS_HOLONOMIC) { }
+
+	AgentParameters::AgentParameters(float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset, float maxAccel, const Vector2 &velocity, float orientation, float timeHorizon, float clusterDist) : velocity_(velocity), maxNeighbors_(maxNeighbors), clusterDist_(clusterDist), goalRadius_(goalRadius), maxAccel_(maxAccel), maxSpeed_(maxSpeed), neighborDist_(neighborDist), orientation_(orientation), prefSpeed_(prefSpeed), radius_(radius), timeHorizon_(timeHorizon), timeToOrientation_(0.0f), uncertaintyOffset_(uncertaintyOffset), wheelTrack_(0.0f), kinematics_(Simulator::KINEMATICS_HOLONOMIC)
+	{
+		computeSquares();
+	}
+
+	void AgentParameters::applyProfile(const AgentParameters &profile, unsigned int overrides)
+	{
+		if ((overrides & PROFILE_CLUSTER_DIST) == 0) {
+			clusterDist_ = profile.clusterDist_;
+		}
+
+		if ((overrides & PROFILE_GOAL_RADIUS) == 0) {
+			goalRadius_ = profile.goalRadius_;
+		}
+
+		if ((overrides & PROFILE_MAX_ACCEL) == 0) {
+			maxAccel_ = profile.maxAccel_;
+		}
+
+		if ((overrides & PROFILE_MAX_NEIGHBORS) == 0) {
+			maxNeighbors_ = profile.maxNeighbors_;
+		}
+
+		if ((overrides & PROFILE_MAX_SPEED) == 0) {
+			maxSpeed_ = profile.maxSpeed_;
+		}
+
+		if ((overrides & PROFILE_NEIGHBOR_DIST) == 0) {
+			neighborDist_ = profile.neighborDist_;
+		}
+
+		if ((overrides & PROFILE_PREF_SPEED) == 0) {
+			prefSpeed_ = profile.prefSpeed_;
+		}
+
+		if ((overrides & PROFILE_RADIUS) == 0) {
+			radius_ = profile.radius_;
+		}
+
+		if ((overrides & PROFILE_TIME_HORIZON) == 0) {
+			timeHorizon_ = profile.timeHorizon_;
+		}
+
+		if ((overrides & PROFILE_UNCERTAINTY_OFFSET) == 0) {
+			uncertaintyOffset_ = profile.uncertaintyOffset_;
+		}
+
+		if ((overrides & PROFILE_TIME_TO_ORIENTATION) == 0) {
+			timeToOrientation_ = profile.timeToOrientation_;
+		}
+
+		if ((overrides & PROFILE_WHEEL_TRACK) == 0) {
+			wheelTrack_ = profile.wheelTrack_;
+		}
+
+		if ((overrides & PROFILE_KINEMATICS) == 0) {
+			kinematics_ = profile.kinematics_;
+		}
+
+		computeSquares();
+	}
+
+	void AgentParameters::computeSquares()
+	{
+		goalRadiusSq_ = goalRadius_ * goalRadius_;
+		maxSpeedSq_ = maxSpeed_ * maxSpeed_;
+		neighborDistSq_ = neighborDist_ * neighborDist_;
+	}
+}
@@ -0,0 +1,140 @@
+/*
+ * AgentParameters.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   AgentParameters.h
+ * \brief  Declares the AgentParameters class.
+ */
+
+#ifndef HRVO_AGENT_PARAMETERS_H_
+#define HRVO_AGENT_PARAMETERS_H_
+
+#include <cstddef>
+
+#include "Simulator.h"
+#include "Vector2.h"
+
+namespace hrvo {
+	/**
+	 * \class    AgentParameters
+	 * \brief    The properties of an agent that a type of agent shares.
+	 *
+	 * \details  The parameters of all agents are stored in the parameter
+	 *           table of the simulation, and each agent refers to its
+	 *           parameters by number. Every agent with an agent profile
+	 *           shares the parameters of the profile, and every agent
+	 *           added with the agent defaults shares the defaults at the
+	 *           time it was added. An agent whose properties are set
+	 *           individually is given parameters of its own, which take any
+	 *           property it has not overridden from its profile.
+	 */
+	class AgentParameters {
+	private:
+		/**
+		 * \brief  The properties that an agent takes from its profile unless they are overridden.
+		 */
+		enum ProfileProperty {
+			PROFILE_GOAL_RADIUS = 1 << 0,
+			PROFILE_MAX_ACCEL = 1 << 1,
+			PROFILE_MAX_NEIGHBORS = 1 << 2,
+			PROFILE_MAX_SPEED = 1 << 3,
+			PROFILE_NEIGHBOR_DIST = 1 << 4,
+			PROFILE_PREF_SPEED = 1 << 5,
+			PROFILE_RADIUS = 1 << 6,
+			PROFILE_TIME_HORIZON = 1 << 7,
+			PROFILE_UNCERTAINTY_OFFSET = 1 << 8,
+			PROFILE_TIME_TO_ORIENTATION = 1 << 9,
+			PROFILE_WHEEL_TRACK = 1 << 10,
+			PROFILE_KINEMATICS = 1 << 11,
+			PROFILE_CLUSTER_DIST = 1 << 12
+		};
+
+		/**
+		 * \brief  Constructor.
+		 */
+		AgentParameters();
+
+		/**
+		 * \brief      Constructor.
+		 * \param[in]  neighborDist       The maximum neighbor distance.
+		 * \param[in]  maxNeighbors       The maximum neighbor count.
+		 * \param[in]  radius             The radius.
+		 * \param[in]  goalRadius         The goal radius.
+		 * \param[in]  prefSpeed          The preferred speed.
+		 * \param[in]  maxSpeed           The maximum speed.
+		 * \param[in]  uncertaintyOffset  The uncertainty offset.
+		 * \param[in]  maxAccel           The maximum acceleration.
+		 * \param[in]  velocity           The initial velocity of a new agent.
+		 * \param[in]  orientation        The initial orientation (in radians) of a new agent.
+		 * \param[in]  timeHorizon        The time horizon.
+		 * \param[in]  clusterDist        The cluster distance.
+		 */
+		AgentParameters(float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset, float maxAccel, const Vector2 &velocity, float orientation, float timeHorizon, float clusterDist);
+
+		/**
+		 * \brief      Copies the properties of a profile that have not been overridden.
+		 * \param[in]  profile    The parameters of the agent profile.
+		 * \param[in]  overrides  The properties that have been overridden.
+		 */
+		void applyProfile(const AgentParameters &profile, unsigned int overrides);
+
+		/**
+		 * \brief  Computes the squares of the goal radius, maximum speed, and maximum neighbor distance, which each step compares against squared distances.
+		 */
+		void computeSquares();
+
+		Vector2 velocity_;
+		std::size_t maxNeighbors_;
+		float clusterDist_;
+		float goalRadius_;
+		float goalRadiusSq_;
+		float maxAccel_;
+		float maxSpeed_;
+		float maxSpeedSq_;
+		float neighborDist_;
+		float neighborDistSq_;
+		float orientation_;
+		float prefSpeed_;
+		float radius_;
+		float timeHorizon_;
+		float timeToOrientation_;
+		float uncertaintyOffset_;
+		float wheelTrack_;
+		Simulator::KinematicModel kinematics_;
+
+		friend class Agent;
+		friend class KdTree;
+		friend class Simulator;
+	};
+}
+
+#endif /* HRVO_AGENT_PARAMETERS_H_ */
@@ -38,12 +38,22 @@
 #ifndef HRVO_DEFINITIONS_H_
 #define HRVO_DEFINITIONS_H_
 
+#include <cmath>
+#include <limits>
+
+#include "Vector2.h"
+
 namespace hrvo {
 	/**
 	 * \brief  A sufficiently small positive float.
 	 */
 	const float HRVO_EPSILON = 0.00001f;
 
+	/**
+	 * \brief  The ratio of the circumference of a circle to its diameter.
+	 */
+	const float HRVO_PI = 3.141592653589793f;
+
 	/**
 	 * \brief      Computes the square of a float.
 	 * \param[in]  scalar  The float to be squared.
@@ -53,6 +63,32 @@ namespace hrvo {
 	{
 		return scalar * scalar;
 	}
+
+	/**
+	 * \brief      Computes the time until two discs moving at constant velocities first touch.
+	 * \param[in]  relativePosition  The position of the second disc relative to the first.
+	 * \param[in]  relativeVelocity  The velocity of the first disc relative to the second.
+	 * \param[in]  radius            The sum of the radii of the discs.
+	 * \return     The time until the discs first touch, zero if they overlap, or infinity if they never touch.
+	 */
+	inline float timeToCollision(const Vector2 &relativePosition, const Vector2 &relativeVelocity, float radius)
+	{
+		const float c = absSq(relativePosition) - sqr(radius);
+
+		if (c <= 0.0f) {
+			return 0.0f;
+		}
+
+		const float b = relativePosition * relativeVelocity;
+		const float a = absSq(relativeVelocity);
+		const float discriminant = sqr(b) - a * c;
+
+		if (b <= 0.0f || discriminant <= 0.0f) {
+			return std::numeric_limits<float>::infinity();
+		}
+
+		return (b - std::sqrt(discriminant)) / a;
+	}
 }
 
 #endif /* HRVO_DEFINITIONS_H_ */
@@ -0,0 +1,272 @@
+/*
+ * FastMath.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   FastMath.h
+ * \brief  Declares and defines internal math functions for the hot paths of the simulation.
+ *
+ * \details  Each fast function calls the standard library unless the library
+ *           is built with HRVO_FAST_MATH set to 1, in which case it calls the
+ *           approx function of the same name, which evaluates a polynomial
+ *           approximation instead and is defined in either mode so that it
+ *           can be tested against the library. The approximations contain no
+ *           library calls other than square roots and no conditions on floats,
+ *           so loops over them can be vectorized; the square roots need
+ *           -fno-math-errno, which the build option also sets. Their maximum
+ *           errors are stated for each function and were measured against the
+ *           double-precision library over the stated domains.
+ */
+
+#ifndef HRVO_FAST_MATH_H_
+#define HRVO_FAST_MATH_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "Definitions.h"
+#include "Vector2.h"
+
+#ifndef HRVO_FAST_MATH
+/**
+ * \brief  Set to 0 for the standard library; set to 1 for polynomial approximations.
+ */
+#define HRVO_FAST_MATH 0
+#endif /* HRVO_FAST_MATH */
+
+namespace hrvo {
+	/**
+	 * \brief      Approximates the arc sine of a float.
+	 * \details    Within 3e-7 on [-1, 1].
+	 * \param[in]  scalar  The float, in [-1, 1].
+	 * \return     The arc sine (in radians) of the float.
+	 */
+	inline float approxAsin(float scalar)
+	{
+		// Abramowitz and Stegun 4.4.46.
+		const float x = std::fabs(scalar);
+		const float polynomial = 1.5707963050f + x * (-0.2145988016f + x * (0.0889789874f + x * (-0.0501743046f + x * (0.0308918810f + x * (-0.0170881256f + x * (0.0066700901f + x * -0.0012624911f))))));
+
+		return std::copysign(0.5f * HRVO_PI - std::sqrt(1.0f - x) * polynomial, scalar);
+	}
+
+	/**
+	 * \brief      Approximates the angle of a point from the positive x-axis.
+	 * \details    Within 2.1e-6.
+	 * \param[in]  y  The y-coordinate of the point.
+	 * \param[in]  x  The x-coordinate of the point.
+	 * \return     The angle (in radians) of the point, in [-pi, pi].
+	 */
+	inline float approxAtan2(float y, float x)
+	{
+		const float absX = std::fabs(x);
+		const float absY = std::fabs(y);
+		const float ratio = std::min(absX, absY) / std::max(std::max(absX, absY), std::numeric_limits<float>::min());
+		const float ratioSq = ratio * ratio;
+
+		// The arc tangent of the ratio in [0, 1], reflected into the octant and then the quadrant of the point by copying signs rather than by conditions on floats, which the compiler would not convert to selects.
+		const float angle = ratio * (0.99997726f + ratioSq * (-0.33262347f + ratioSq * (0.19354346f + ratioSq * (-0.11643287f + ratioSq * (0.05265332f + ratioSq * -0.01172120f)))));
+		const float firstQuadrant = 0.25f * HRVO_PI - std::copysign(0.25f * HRVO_PI - angle, absX - absY);
+
+		return std::copysign(0.5f * HRVO_PI + std::copysign(firstQuadrant - 0.5f * HRVO_PI, -x), y);
+	}
+
+	/**
+	 * \brief      Approximates the reciprocal of the square root of a float.
+	 * \details    Within a relative error of 5e-6.
+	 * \param[in]  scalar  The float, which is positive.
+	 * \return     The reciprocal of the square root of the float.
+	 */
+	inline float approxInvSqrt(float scalar)
+	{
+		// An initial estimate from the bits of the float, refined by two Newton iterations.
+		unsigned int bits;
+		std::memcpy(&bits, &scalar, sizeof(bits));
+		bits = 0x5f375a86u - (bits >> 1);
+
+		float estimate;
+		std::memcpy(&estimate, &bits, sizeof(estimate));
+		estimate *= 1.5f - 0.5f * scalar * estimate * estimate;
+		estimate *= 1.5f - 0.5f * scalar * estimate * estimate;
+
+		return estimate;
+	}
+
+	/**
+	 * \brief      Approximates the sine and cosine of an angle.
+	 * \details    Within 1e-7 for angles within [-1000, 1000].
+	 * \param[in]  angle   The angle (in radians).
+	 * \param[out] sine    The sine of the angle.
+	 * \param[out] cosine  The cosine of the angle.
+	 */
+	inline void approxSinCos(float angle, float &sine, float &cosine)
+	{
+		// The angle is reduced by the nearest multiple of pi/2, rounded by adding and subtracting 1.5 * 2^23 and subtracted in three parts so that the reduction is exact.
+		const float quadrant = (angle * (2.0f / HRVO_PI) + 12582912.0f) - 12582912.0f;
+		const int octant = static_cast<int>(quadrant);
+		const float reduced = ((angle - quadrant * 1.5703125f) - quadrant * 4.837512969970703125e-4f) - quadrant * 7.54978995489188216e-8f;
+		const float reducedSq = reduced * reduced;
+
+		// Minimax polynomials on [-pi/4, pi/4].
+		const float reducedSine = reduced + reduced * reducedSq * (-1.6666654611e-1f + reducedSq * (8.3321608736e-3f + reducedSq * -1.9515295891e-4f));
+		const float reducedCosine = 1.0f - 0.5f * reducedSq + reducedSq * reducedSq * (4.166664568298827e-2f + reducedSq * (-1.388731625493765e-3f + reducedSq * 2.443315711809948e-5f));
+
+		const float swappedSine = (octant & 1) != 0 ? reducedCosine : reducedSine;
+		const float swappedCosine = (octant & 1) != 0 ? reducedSine : reducedCosine;
+		sine = (octant & 2) != 0 ? -swappedSine : swappedSine;
+		cosine = ((octant + 1) & 2) != 0 ? -swappedCosine : swappedCosine;
+	}
+
+	/**
+	 * \brief      Wraps an angle into [-pi, pi] by subtracting the nearest multiple of 2 pi.
+	 * \param[in]  angle  The angle (in radians).
+	 * \return     The angle that differs from the angle by a multiple of 2 pi, in [-pi, pi].
+	 */
+	inline float approxWrapAngle(float angle)
+	{
+		return angle - (2.0f * HRVO_PI) * ((angle * (0.5f / HRVO_PI) + 12582912.0f) - 12582912.0f);
+	}
+
+	/**
+	 * \brief      Computes the arc sine of a float.
+	 * \param[in]  scalar  The float, in [-1, 1].
+	 * \return     The arc sine (in radians) of the float.
+	 */
+	inline float fastAsin(float scalar)
+	{
+#if HRVO_FAST_MATH
+		return approxAsin(scalar);
+#else /* HRVO_FAST_MATH */
+		return std::asin(scalar);
+#endif /* HRVO_FAST_MATH */
+	}
+
+	/**
+	 * \brief      Computes the angle of a point from the positive x-axis.
+	 * \param[in]  y  The y-coordinate of the point.
+	 * \param[in]  x  The x-coordinate of the point.
+	 * \return     The angle (in radians) of the point, in [-pi, pi].
+	 */
+	inline float fastAtan2(float y, float x)
+	{
+#if HRVO_FAST_MATH
+		return approxAtan2(y, x);
+#else /* HRVO_FAST_MATH */
+		return std::atan2(y, x);
+#endif /* HRVO_FAST_MATH */
+	}
+
+	/**
+	 * \brief      Computes the angle of a vector from the positive x-axis.
+	 * \param[in]  vector  The vector.
+	 * \return     The angle (in radians) of the vector, in [-pi, pi].
+	 */
+	inline float fastAtan(const Vector2 &vector)
+	{
+#if HRVO_FAST_MATH
+		return approxAtan2(vector.getY(), vector.getX());
+#else /* HRVO_FAST_MATH */
+		return atan(vector);
+#endif /* HRVO_FAST_MATH */
+	}
+
+	/**
+	 * \brief      Computes the reciprocal of the square root of a float.
+	 * \param[in]  scalar  The float, which is positive.
+	 * \return     The reciprocal of the square root of the float.
+	 */
+	inline float fastInvSqrt(float scalar)
+	{
+#if HRVO_FAST_MATH
+		return approxInvSqrt(scalar);
+#else /* HRVO_FAST_MATH */
+		return 1.0f / std::sqrt(scalar);
+#endif /* HRVO_FAST_MATH */
+	}
+
+	/**
+	 * \brief      Computes the normalization of a vector.
+	 * \param[in]  vector  The vector, which is not zero.
+	 * \return     The vector of unit length in the direction of the vector.
+	 */
+	inline Vector2 fastNormalize(const Vector2 &vector)
+	{
+#if HRVO_FAST_MATH
+		return approxInvSqrt(absSq(vector)) * vector;
+#else /* HRVO_FAST_MATH */
+		return normalize(vector);
+#endif /* HRVO_FAST_MATH */
+	}
+
+	/**
+	 * \brief      Computes the sine and cosine of an angle.
+	 * \param[in]  angle   The angle (in radians).
+	 * \param[out] sine    The sine of the angle.
+	 * \param[out] cosine  The cosine of the angle.
+	 */
+	inline void fastSinCos(float angle, float &sine, float &cosine)
+	{
+#if HRVO_FAST_MATH
+		approxSinCos(angle, sine, cosine);
+#else /* HRVO_FAST_MATH */
+		sine = std::sin(angle);
+		cosine = std::cos(angle);
+#endif /* HRVO_FAST_MATH */
+	}
+
+	/**
+	 * \brief      Wraps an angle into [-pi, pi].
+	 * \param[in]  angle  The angle (in radians).
+	 * \return     The angle that differs from the angle by a multiple of 2 pi, in [-pi, pi].
+	 */
+	inline float fastWrapAngle(float angle)
+	{
+#if HRVO_FAST_MATH
+		return approxWrapAngle(angle);
+#else /* HRVO_FAST_MATH */
+		float wrapped = std::fmod(angle, 2.0f * HRVO_PI);
+
+		if (wrapped < -HRVO_PI) {
+			wrapped += 2.0f * HRVO_PI;
+		}
+
+		if (wrapped > HRVO_PI) {
+			wrapped -= 2.0f * HRVO_PI;
+		}
+
+		return wrapped;
+#endif /* HRVO_FAST_MATH */
+	}
+}
+
+#endif /* HRVO_FAST_MATH_H_ */
@@ -38,35 +38,36 @@
 #ifndef HRVO_GOAL_H_
 #define HRVO_GOAL_H_
 
-#include <vector>
-#include "Vector2.h"
+#include <cstddef>
+#include <memory>
 
 namespace hrvo {
-	class Simulator;
+	class Trajectory;
 
 	/**
-	 * \class  Goal
-	 * \brief  A goal in the simulation.
+	 * \class    Goal
+	 * \brief    A goal in the simulation; a route through one or more waypoints.
+	 *
+	 * \details  The waypoints of all goals are stored in order in the flat
+	 *           waypoint pool of the simulation, which changes in place only
+	 *           when Simulator::setAgentGoalPosition() moves the goal it has
+	 *           added for an agent number, and each agent
+	 *           keeps its own cursor into the route of its goal, so that any
+	 *           number of agents may share a goal. A goal may instead be a
+	 *           trajectory, whose route is its final position.
 	 */
 	class Goal {
 	private:
 		/**
 		 * \brief      Constructor.
-		 * \param[in]  position  The position of this goal.
+		 * \param[in]  begin  The index of the first waypoint of this goal in the waypoint pool.
+		 * \param[in]  end    The index past the last waypoint of this goal in the waypoint pool.
 		 */
-		explicit Goal(const Vector2 &position);
-		explicit Goal(std::vector<Vector2> positions);
-
-    public:
-		Vector2 position_;
-        // Goal positions in order Could be Queue
-        std::vector<Vector2> positions_;
-        int currGoalIndex = 0;
-
-        Vector2 getNextGoalPostion();
-        Vector2 getCurrentGoalPosition();
-        bool isGoingToFinalGoal();
+		Goal(std::size_t begin, std::size_t end);
 
+		std::shared_ptr<const Trajectory> trajectory_;
+		std::size_t begin_;
+		std::size_t end_;
 
 		friend class Agent;
 		friend class Simulator;
@@ -61,8 +61,13 @@
  *             and change their trajectories accordingly.
  */
 
+#include "AgentHandle.h"
 #include "Export.h"
+#include "Rollout.h"
 #include "Simulator.h"
+#include "Snapshot.h"
+#include "Trajectory.h"
 #include "Vector2.h"
+#include "VelocitySolver.h"
 
 #endif
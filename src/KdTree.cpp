@@ -38,6 +38,7 @@
 #include "KdTree.h"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 
 #include "Agent.h"
@@ -45,21 +46,63 @@
 #include "Simulator.h"
 
 namespace hrvo {
-	KdTree::KdTree(Simulator *simulator) : simulator_(simulator) { }
+	KdTree::KdTree(Simulator *simulator) : simulator_(simulator), bruteForceThreshold_(HRVO_BRUTE_FORCE_THRESHOLD), maxLeafSize_(HRVO_MAX_LEAF_SIZE), numAgents_(0), splitRule_(SPLIT_MIDPOINT), agentsChanged_(false), bruteForce_(false), surfaceDistance_(false) { }
 
 	void KdTree::build()
 	{
 		agents_.reserve(simulator_->agents_.size());
 
-		for (std::size_t i = agents_.size(); i < simulator_->agents_.size(); ++i) {
-			agents_.push_back(i);
+		if (agentsChanged_ || numAgents_ > simulator_->agents_.size()) {
+			std::vector<char> listed(simulator_->agents_.size(), 0);
+			std::size_t numListed = 0;
+
+			for (std::vector<std::size_t>::const_iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
+				if (*iter < simulator_->agents_.size() && !simulator_->agents_[*iter]->removed_) {
+					listed[*iter] = 1;
+					agents_[numListed++] = *iter;
+				}
+			}
+
+			agents_.resize(numListed);
+			numAgents_ = 0;
+			agentsChanged_ = false;
+
+			for (std::size_t i = 0; i < simulator_->agents_.size(); ++i) {
+				if (listed[i] == 0 && !simulator_->agents_[i]->removed_) {
+					agents_.push_back(i);
+				}
+			}
 		}
+		else {
+			for (std::size_t i = numAgents_; i < simulator_->agents_.size(); ++i) {
+				if (!simulator_->agents_[i]->removed_) {
+					agents_.push_back(i);
+				}
+			}
+		}
+
+		numAgents_ = simulator_->agents_.size();
+		bruteForce_ = agents_.size() <= bruteForceThreshold_;
 
-		nodes_.resize(2 * simulator_->agents_.size() - 1);
+		// Packed positions are indexed by agent number; removed agents are skipped when neighbors are inserted.
+		if (bruteForce_) {
+			positionsX_.resize(simulator_->agents_.size());
+			positionsY_.resize(simulator_->agents_.size());
+			radii_.resize(simulator_->agents_.size());
 
-		if (!agents_.empty()) {
+			for (std::size_t i = 0; i < simulator_->agents_.size(); ++i) {
+				positionsX_[i] = simulator_->agents_[i]->position_.getX();
+				positionsY_[i] = simulator_->agents_[i]->position_.getY();
+				radii_[i] = simulator_->agents_[i]->getParameters().radius_;
+			}
+		}
+		else if (!agents_.empty()) {
+			nodes_.resize(2 * agents_.size() - 1);
 			buildRecursive(0, agents_.size(), 0);
 		}
+		else {
+			nodes_.clear();
+		}
 	}
 
 	void KdTree::buildRecursive(std::size_t begin, std::size_t end, std::size_t node)
@@ -68,8 +111,11 @@ namespace hrvo {
 		nodes_[node].end_ = end;
 		nodes_[node].minX_ = nodes_[node].maxX_ = simulator_->agents_[agents_[begin]]->position_.getX();
 		nodes_[node].minY_ = nodes_[node].maxY_ = simulator_->agents_[agents_[begin]]->position_.getY();
+		nodes_[node].maxRadius_ = simulator_->agents_[agents_[begin]]->getParameters().radius_;
 
 		for (std::size_t i = begin + 1; i < end; ++i) {
+			nodes_[node].maxRadius_ = std::max(nodes_[node].maxRadius_, simulator_->agents_[agents_[i]]->getParameters().radius_);
+
 			if (simulator_->agents_[agents_[i]]->position_.getX() > nodes_[node].maxX_) {
 				nodes_[node].maxX_ = simulator_->agents_[agents_[i]]->position_.getX();
 			}
@@ -85,104 +131,243 @@ namespace hrvo {
 			}
 		}
 
-		if (end - begin > HRVO_MAX_LEAF_SIZE) {
+		if (end - begin > maxLeafSize_) {
 			const bool vertical = nodes_[node].maxX_ - nodes_[node].minX_ > nodes_[node].maxY_ - nodes_[node].minY_;
-			const float split = 0.5f * (vertical ?  nodes_[node].maxX_ + nodes_[node].minX_ : nodes_[node].maxY_ + nodes_[node].minY_);
+			std::size_t left;
 
-			std::size_t left = begin;
-			std::size_t right = end - 1;
+			if (splitRule_ == SPLIT_MEDIAN) {
+				left = begin + (end - begin) / 2;
 
-			while (true) {
-				while (left <= right && (vertical ? simulator_->agents_[agents_[left]]->position_.getX()
-										 : simulator_->agents_[agents_[left]]->position_.getY()) < split) {
-					++left;
-				}
+				const Simulator *const simulator = simulator_;
 
-				while (right >= left && (vertical ? simulator_->agents_[agents_[right]]->position_.getX()
-										 : simulator_->agents_[agents_[right]]->position_.getY()) >= split) {
-					--right;
-				}
+				std::nth_element(agents_.begin() + begin, agents_.begin() + left, agents_.begin() + end, [simulator, vertical](std::size_t agentNo1, std::size_t agentNo2) {
+					return vertical ? simulator->agents_[agentNo1]->position_.getX() < simulator->agents_[agentNo2]->position_.getX()
+						: simulator->agents_[agentNo1]->position_.getY() < simulator->agents_[agentNo2]->position_.getY();
+				});
+			}
+			else {
+				const float split = 0.5f * (vertical ?  nodes_[node].maxX_ + nodes_[node].minX_ : nodes_[node].maxY_ + nodes_[node].minY_);
+
+				left = begin;
+				std::size_t right = end - 1;
 
-				if (left > right) {
-					break;
+				while (true) {
+					while (left <= right && (vertical ? simulator_->agents_[agents_[left]]->position_.getX()
+											 : simulator_->agents_[agents_[left]]->position_.getY()) < split) {
+						++left;
+					}
+
+					while (right >= left && (vertical ? simulator_->agents_[agents_[right]]->position_.getX()
+											 : simulator_->agents_[agents_[right]]->position_.getY()) >= split) {
+						--right;
+					}
+
+					if (left > right) {
+						break;
+					}
+					else {
+						std::swap(agents_[left], agents_[right]);
+						++left;
+						--right;
+					}
 				}
-				else {
-					std::swap(agents_[left], agents_[right]);
+
+				if (left == begin) {
 					++left;
-					--right;
 				}
 			}
 
-			if (left == begin) {
-				++left;
-				++right;
-			}
-
 			nodes_[node].left_ = node + 1;
 			nodes_[node].right_ = 2 * (left - begin) + node;
+			nodes_[nodes_[node].left_].parent_ = node;
+			nodes_[nodes_[node].right_].parent_ = node;
 
 			buildRecursive(begin, left, nodes_[node].left_);
 			buildRecursive(left, end, nodes_[node].right_);
 		}
+		else {
+			nodes_[node].left_ = 0;
+			nodes_[node].right_ = 0;
+
+			for (std::size_t i = begin; i < end; ++i) {
+				simulator_->agents_[agents_[i]]->leaf_ = node;
+			}
+		}
 	}
 
-	void KdTree::queryRecursive(Agent *agent, float &rangeSq, std::size_t node) const
+	float KdTree::distSqToAgent(const Agent *agent, std::size_t agentNo) const
 	{
-		if (nodes_[node].end_ - nodes_[node].begin_ <= HRVO_MAX_LEAF_SIZE) {
-			for (std::size_t i = nodes_[node].begin_; i < nodes_[node].end_; ++i) {
-				agent->insertNeighbor(agents_[i], rangeSq);
-			}
+		const Agent *const other = simulator_->agents_[agentNo];
+		const float distSq = absSq(agent->position_ - other->position_);
+
+		if (surfaceDistance_) {
+			return surfaceDistSq(distSq, agent->getParameters().radius_, other->getParameters().radius_);
+		}
+
+		return distSq;
+	}
+
+	float KdTree::distSqToNode(const Agent *agent, std::size_t node) const
+	{
+		const Vector2 &position = agent->position_;
+		float distSq = 0.0f;
+
+		if (position.getX() < nodes_[node].minX_) {
+			distSq += sqr(nodes_[node].minX_ - position.getX());
+		}
+		else if (position.getX() > nodes_[node].maxX_) {
+			distSq += sqr(position.getX() - nodes_[node].maxX_);
+		}
+
+		if (position.getY() < nodes_[node].minY_) {
+			distSq += sqr(nodes_[node].minY_ - position.getY());
+		}
+		else if (position.getY() > nodes_[node].maxY_) {
+			distSq += sqr(position.getY() - nodes_[node].maxY_);
 		}
-		else {
-			float distSqLeft = 0.0f;
-			float distSqRight = 0.0f;
 
-			if (agent->position_.getX() < nodes_[nodes_[node].left_].minX_) {
-				distSqLeft += sqr(nodes_[nodes_[node].left_].minX_ - agent->position_.getX());
+		if (surfaceDistance_) {
+			return surfaceDistSq(distSq, agent->getParameters().radius_, nodes_[node].maxRadius_);
+		}
+
+		return distSq;
+	}
+
+	void KdTree::query(Agent *agent, float rangeSq) const
+	{
+		if (bruteForce_) {
+			queryBruteForce(agent, rangeSq);
+
+			return;
+		}
+
+		std::size_t node = agent->leaf_;
+
+		queryRecursive(agent, rangeSq, node);
+
+		while (node != 0) {
+			const std::size_t parent = nodes_[node].parent_;
+			const std::size_t sibling = nodes_[parent].left_ == node ? nodes_[parent].right_ : nodes_[parent].left_;
+
+			if (distSqToNode(agent, sibling) <= rangeSq) {
+				queryRecursive(agent, rangeSq, sibling);
 			}
-			else if (agent->position_.getX() > nodes_[nodes_[node].left_].maxX_) {
-				distSqLeft += sqr(agent->position_.getX() - nodes_[nodes_[node].left_].maxX_);
+
+			node = parent;
+		}
+	}
+
+	float KdTree::queryNearest(const Agent *agent, float rangeSq) const
+	{
+		if (bruteForce_) {
+			for (std::size_t i = 0; i < positionsX_.size(); ++i) {
+				if (simulator_->agents_[i] != agent && !simulator_->agents_[i]->removed_) {
+					rangeSq = std::min(rangeSq, distSqToAgent(agent, i));
+				}
 			}
+		}
+		else if (!nodes_.empty()) {
+			queryNearestRecursive(agent, rangeSq, 0);
+		}
 
-			if (agent->position_.getY() < nodes_[nodes_[node].left_].minY_) {
-				distSqLeft += sqr(nodes_[nodes_[node].left_].minY_ - agent->position_.getY());
+		return rangeSq;
+	}
+
+	void KdTree::queryNearestRecursive(const Agent *agent, float &rangeSq, std::size_t node) const
+	{
+		if (nodes_[node].left_ == 0) {
+			for (std::size_t i = nodes_[node].begin_; i < nodes_[node].end_; ++i) {
+				if (simulator_->agents_[agents_[i]] != agent) {
+					rangeSq = std::min(rangeSq, distSqToAgent(agent, agents_[i]));
+				}
 			}
-			else if (agent->position_.getY() > nodes_[nodes_[node].left_].maxY_) {
-				distSqLeft += sqr(agent->position_.getY() - nodes_[nodes_[node].left_].maxY_);
+		}
+		else {
+			const float distSqLeft = distSqToNode(agent, nodes_[node].left_);
+			const float distSqRight = distSqToNode(agent, nodes_[node].right_);
+			const std::size_t nearer = distSqLeft < distSqRight ? nodes_[node].left_ : nodes_[node].right_;
+			const std::size_t farther = distSqLeft < distSqRight ? nodes_[node].right_ : nodes_[node].left_;
+
+			if (std::min(distSqLeft, distSqRight) < rangeSq) {
+				queryNearestRecursive(agent, rangeSq, nearer);
+
+				if (std::max(distSqLeft, distSqRight) < rangeSq) {
+					queryNearestRecursive(agent, rangeSq, farther);
+				}
 			}
+		}
+	}
 
-			if (agent->position_.getX() < nodes_[nodes_[node].right_].minX_) {
-				distSqRight += sqr(nodes_[nodes_[node].right_].minX_ - agent->position_.getX());
+	void KdTree::queryBruteForce(Agent *agent, float rangeSq) const
+	{
+		const float x = agent->position_.getX();
+		const float y = agent->position_.getY();
+		const float radius = agent->getParameters().radius_;
+		float distSq[HRVO_BRUTE_FORCE_BLOCK_SIZE];
+
+		for (std::size_t begin = 0; begin < positionsX_.size(); begin += HRVO_BRUTE_FORCE_BLOCK_SIZE) {
+			const std::size_t size = positionsX_.size() - begin < HRVO_BRUTE_FORCE_BLOCK_SIZE ? positionsX_.size() - begin : HRVO_BRUTE_FORCE_BLOCK_SIZE;
+			const float *const positionsX = &positionsX_[begin];
+			const float *const positionsY = &positionsY_[begin];
+
+			// Branch-free so that the compiler vectorizes it.
+			for (std::size_t i = 0; i < size; ++i) {
+				distSq[i] = sqr(positionsX[i] - x) + sqr(positionsY[i] - y);
 			}
-			else if (agent->position_.getX() > nodes_[nodes_[node].right_].maxX_) {
-				distSqRight += sqr(agent->position_.getX() - nodes_[nodes_[node].right_].maxX_);
+
+			if (surfaceDistance_) {
+				const float *const radii = &radii_[begin];
+
+				for (std::size_t i = 0; i < size; ++i) {
+					distSq[i] = surfaceDistSq(distSq[i], radius, radii[i]);
+				}
 			}
 
-			if (agent->position_.getY() < nodes_[nodes_[node].right_].minY_) {
-				distSqRight += sqr(nodes_[nodes_[node].right_].minY_ - agent->position_.getY());
+			for (std::size_t i = 0; i < size; ++i) {
+				if (distSq[i] <= rangeSq) {
+					agent->insertNeighbor(begin + i, distSq[i], rangeSq);
+				}
 			}
-			else if (agent->position_.getY() > nodes_[nodes_[node].right_].maxY_) {
-				distSqRight += sqr(agent->position_.getY() - nodes_[nodes_[node].right_].maxY_);
+		}
+	}
+
+	void KdTree::queryRecursive(Agent *agent, float &rangeSq, std::size_t node) const
+	{
+		if (nodes_[node].left_ == 0) {
+			for (std::size_t i = nodes_[node].begin_; i < nodes_[node].end_; ++i) {
+				agent->insertNeighbor(agents_[i], distSqToAgent(agent, agents_[i]), rangeSq);
 			}
+		}
+		else {
+			const float distSqLeft = distSqToNode(agent, nodes_[node].left_);
+			const float distSqRight = distSqToNode(agent, nodes_[node].right_);
 
 			if (distSqLeft < distSqRight) {
-				if (distSqLeft < rangeSq) {
+				if (distSqLeft <= rangeSq) {
 					queryRecursive(agent, rangeSq, nodes_[node].left_);
 
-					if (distSqRight < rangeSq) {
+					if (distSqRight <= rangeSq) {
 						queryRecursive(agent, rangeSq, nodes_[node].right_);
 					}
 				}
 			}
 			else {
-				if (distSqRight < rangeSq) {
+				if (distSqRight <= rangeSq) {
 					queryRecursive(agent, rangeSq, nodes_[node].right_);
 
-					if (distSqLeft < rangeSq) {
+					if (distSqLeft <= rangeSq) {
 						queryRecursive(agent, rangeSq, nodes_[node].left_);
 					}
 				}
 			}
 		}
 	}
+
+	float KdTree::surfaceDistSq(float distSq, float radius, float otherRadius)
+	{
+		// Every query computes surface distances here, in the same order of operations, so that brute force and the k-D tree find the same neighbors.
+		const float dist = std::max(std::sqrt(distSq) - radius - otherRadius, 0.0f);
+
+		return dist * dist;
+	}
 }
@@ -53,6 +53,21 @@ namespace hrvo {
 	 */
 	class KdTree {
 	private:
+		/**
+		 * \brief  Rules for choosing the position at which a k-D tree node is split.
+		 */
+		enum SplitRule {
+			/**
+			 * \brief  Split at the midpoint of the longest side of the bounding box.
+			 */
+			SPLIT_MIDPOINT,
+
+			/**
+			 * \brief  Split at the median agent along the longest side of the bounding box.
+			 */
+			SPLIT_MEDIAN
+		};
+
 		/**
 		 * \class  Node
 		 * \brief  Defines a k-D tree node.
@@ -62,7 +77,7 @@ namespace hrvo {
 			/**
 			 * \brief  Constructor.
 			 */
-			Node() : begin_(0), end_(0), left_(0), right_(0), maxX_(0.0f), maxY_(0.0f), minX_(0.0f), minY_(0.0f) { }
+			Node() : begin_(0), end_(0), left_(0), parent_(0), right_(0), maxRadius_(0.0f), maxX_(0.0f), maxY_(0.0f), minX_(0.0f), minY_(0.0f) { }
 
 			/**
 			 * \brief  The beginning node number.
@@ -79,11 +94,21 @@ namespace hrvo {
 			 */
 			std::size_t left_;
 
+			/**
+			 * \brief  The parent node number.
+			 */
+			std::size_t parent_;
+
 			/**
 			 * \brief  The right node number.
 			 */
 			std::size_t right_;
 
+			/**
+			 * \brief  The maximum radius of an agent.
+			 */
+			float maxRadius_;
+
 			/**
 			 * \brief  The maximum x-coordinate.
 			 */
@@ -106,10 +131,20 @@ namespace hrvo {
 		};
 
 		/**
-		 * \brief  The maximum leaf size of a k-D tree.
+		 * \brief  The default maximum leaf size of a k-D tree.
 		 */
 		static const std::size_t HRVO_MAX_LEAF_SIZE = 10;
 
+		/**
+		 * \brief  The default maximum number of agents for which neighbors are computed by brute force rather than with a k-D tree.
+		 */
+		static const std::size_t HRVO_BRUTE_FORCE_THRESHOLD = 64;
+
+		/**
+		 * \brief  The number of squared distances computed at once during a brute-force query.
+		 */
+		static const std::size_t HRVO_BRUTE_FORCE_BLOCK_SIZE = 64;
+
 		/**
 		 * \brief      Constructor.
 		 * \param[in]  simulator  The simulation.
@@ -117,7 +152,13 @@ namespace hrvo {
 		explicit KdTree(Simulator *simulator);
 
 		/**
-		 * \brief  Builds an agent k-D tree.
+		 * \brief  Builds an agent k-D tree, or packs the agent positions if there are few enough agents to compute neighbors by brute force.
+		 *
+		 * \details  The order of the agents is kept from the last build, so
+		 *           that it is already close to sorted. Agents added since are
+		 *           appended; if any agent has been removed or its number
+		 *           reused, removed agents are dropped and the others appended
+		 *           in one pass.
 		 */
 		void build();
 
@@ -129,15 +170,57 @@ namespace hrvo {
 		 */
 		void buildRecursive(std::size_t begin, std::size_t end, std::size_t node);
 
+		/**
+		 * \brief      Computes the squared distance from an agent to another agent, between their surfaces if surface distances are used or else between their centers.
+		 * \param[in]  agent    A pointer to the agent.
+		 * \param[in]  agentNo  The number of the other agent.
+		 * \return     The squared distance between the agents.
+		 */
+		float distSqToAgent(const Agent *agent, std::size_t agentNo) const;
+
+		/**
+		 * \brief      Computes a lower bound on the squared distance from an agent to any agent in a k-D tree node, between their surfaces if surface distances are used or else between their centers.
+		 * \param[in]  agent  A pointer to the agent.
+		 * \param[in]  node   The k-D tree node.
+		 * \return     The squared distance from the agent to the bounding box of the node.
+		 */
+		float distSqToNode(const Agent *agent, std::size_t node) const;
+
 		/**
 		 * \brief      Computes the neighbors of the specified agent.
+		 *
+		 * \details    The query starts at the leaf containing the agent, so that
+		 *             the nearest agents are found first, and walks up the tree
+		 *             visiting the sibling of each node only if its bounding box
+		 *             is within range.
+		 *
 		 * \param[in]  agent    A pointer to the agent for which neighbors are to be computed.
 		 * \param[in]  rangeSq  The squared range around the agent.
 		 */
-		void query(Agent *agent, float rangeSq) const
-		{
-			queryRecursive(agent, rangeSq, 0);
-		}
+		void query(Agent *agent, float rangeSq) const;
+
+		/**
+		 * \brief      Computes the squared distance from the specified agent to the nearest other agent, between their surfaces if surface distances are used or else between their centers.
+		 * \param[in]  agent    A pointer to the agent.
+		 * \param[in]  rangeSq  The squared range around the agent.
+		 * \return     The squared distance to the nearest other agent, or the squared range if there is none within it.
+		 */
+		float queryNearest(const Agent *agent, float rangeSq) const;
+
+		/**
+		 * \brief          Recursive function to compute the squared distance from the specified agent to the nearest other agent.
+		 * \param[in]      agent    A pointer to the agent.
+		 * \param[in,out]  rangeSq  The squared range around the agent, reduced to the squared distance to the nearest other agent found.
+		 * \param[in]      node     The current k-D tree node.
+		 */
+		void queryNearestRecursive(const Agent *agent, float &rangeSq, std::size_t node) const;
+
+		/**
+		 * \brief      Computes the neighbors of the specified agent by testing the packed positions of all agents.
+		 * \param[in]  agent    A pointer to the agent for which neighbors are to be computed.
+		 * \param[in]  rangeSq  The squared range around the agent.
+		 */
+		void queryBruteForce(Agent *agent, float rangeSq) const;
 
 		/**
 		 * \brief          Recursive function to compute the neighbors of the specified agent.
@@ -147,11 +230,31 @@ namespace hrvo {
 		 */
 		void queryRecursive(Agent *agent, float &rangeSq, std::size_t node) const;
 
+		/**
+		 * \brief      Computes the squared distance between the surfaces of an agent and another agent or a k-D tree node from the squared distance between their centers.
+		 * \param[in]  distSq       The squared distance between the centers.
+		 * \param[in]  radius       The radius of the agent.
+		 * \param[in]  otherRadius  The radius of the other agent, or the greatest radius in the node.
+		 * \return     The squared distance between the surfaces, or zero if they overlap.
+		 */
+		static float surfaceDistSq(float distSq, float radius, float otherRadius);
+
 		Simulator *const simulator_;
+		std::size_t bruteForceThreshold_;
+		std::size_t maxLeafSize_;
+		std::size_t numAgents_;
+		SplitRule splitRule_;
+		bool agentsChanged_;
+		bool bruteForce_;
+		bool surfaceDistance_;
 		std::vector<std::size_t> agents_;
 		std::vector<Node> nodes_;
+		std::vector<float> positionsX_;
+		std::vector<float> positionsY_;
+		std::vector<float> radii_;
 
 		friend class Agent;
+		friend class NeighborTuner;
 		friend class Simulator;
 	};
 }
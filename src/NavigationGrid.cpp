@@ -0,0 +1,361 @@
+/*
+ * NavigationGrid.cpp
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   NavigationGrid.cpp
+ * \brief  Defines the NavigationGrid class.
+ */
+
+#include "NavigationGrid.h"
+
+#include <cmath>
+
+#include "Definitions.h"
+
+namespace hrvo {
+	const std::size_t NavigationGrid::HRVO_NAVIGATION_GRID_NO_CELL;
+
+	NavigationGrid::NavigationGrid(const Vector2 &origin, std::size_t numColumns, std::size_t numRows, float cellSize) : blocked_(numColumns * numRows, 0), origin_(origin), numColumns_(numColumns), numRows_(numRows), cellSize_(cellSize) { }
+
+	void NavigationGrid::evictUnused()
+	{
+		for (std::map<std::size_t, CachedFlowField>::iterator iter = fields_.begin(); iter != fields_.end(); ) {
+			if (iter->second.used_) {
+				iter->second.used_ = false;
+				++iter;
+			}
+			else {
+				fields_.erase(iter++);
+			}
+		}
+	}
+
+	std::size_t NavigationGrid::getCell(const Vector2 &position) const
+	{
+		const float column = std::floor((position.getX() - origin_.getX()) / cellSize_);
+		const float row = std::floor((position.getY() - origin_.getY()) / cellSize_);
+
+		if (!(column >= 0.0f && row >= 0.0f && column < static_cast<float>(numColumns_) && row < static_cast<float>(numRows_))) {
+			return HRVO_NAVIGATION_GRID_NO_CELL;
+		}
+
+		return static_cast<std::size_t>(row) * numColumns_ + static_cast<std::size_t>(column);
+	}
+
+	bool NavigationGrid::getCellBlocked(const Vector2 &position) const
+	{
+		const std::size_t cell = getCell(position);
+
+		return cell != HRVO_NAVIGATION_GRID_NO_CELL && blocked_[cell] != 0;
+	}
+
+	bool NavigationGrid::getFlow(const Vector2 &waypoint, const Vector2 &position, Vector2 &direction, float &dist) const
+	{
+		const std::map<std::size_t, CachedFlowField>::const_iterator iter = fields_.find(getCell(waypoint));
+
+		if (iter == fields_.end()) {
+			return false;
+		}
+
+		const FlowField &field = *iter->second.field_;
+
+		// Cell centers lie half a cell from the cell corners.
+		const float x = (position.getX() - origin_.getX()) / cellSize_ - 0.5f;
+		const float y = (position.getY() - origin_.getY()) / cellSize_ - 0.5f;
+		const float column = std::floor(x);
+		const float row = std::floor(y);
+		const float s = x - column;
+		const float t = y - row;
+
+		Vector2 sumDirection;
+		float sumDist = 0.0f;
+		float sumWeight = 0.0f;
+
+		for (int j = 0; j < 2; ++j) {
+			for (int i = 0; i < 2; ++i) {
+				const float cornerColumn = column + static_cast<float>(i);
+				const float cornerRow = row + static_cast<float>(j);
+
+				if (cornerColumn < 0.0f || cornerRow < 0.0f || cornerColumn >= static_cast<float>(numColumns_) || cornerRow >= static_cast<float>(numRows_)) {
+					continue;
+				}
+
+				const std::size_t cell = static_cast<std::size_t>(cornerRow) * numColumns_ + static_cast<std::size_t>(cornerColumn);
+
+				if (cell == field.goalCell_) {
+					return false;
+				}
+
+				if (field.parents_[cell] == HRVO_NAVIGATION_GRID_NO_CELL) {
+					continue;
+				}
+
+				const std::size_t parent = field.parents_[cell];
+				const Vector2 step(static_cast<float>(parent % numColumns_) - cornerColumn, static_cast<float>(parent / numColumns_) - cornerRow);
+				const float weight = (i == 0 ? 1.0f - s : s) * (j == 0 ? 1.0f - t : t);
+
+				sumDirection += weight * normalize(step);
+				sumDist += weight * field.distances_[cell];
+				sumWeight += weight;
+			}
+		}
+
+		if (sumWeight <= HRVO_EPSILON || absSq(sumDirection) <= HRVO_EPSILON) {
+			return false;
+		}
+
+		direction = normalize(sumDirection);
+		dist = sumDist / sumWeight;
+
+		return true;
+	}
+
+	std::size_t NavigationGrid::getMoves(std::size_t cell, std::size_t neighbors[8], float costs[8]) const
+	{
+		const std::size_t column = cell % numColumns_;
+		const std::size_t row = cell / numColumns_;
+		std::size_t numMoves = 0;
+
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if ((dx == 0 && dy == 0) || (dx < 0 && column == 0) || (dy < 0 && row == 0) || (dx > 0 && column + 1 == numColumns_) || (dy > 0 && row + 1 == numRows_)) {
+					continue;
+				}
+
+				const std::size_t neighbor = cell + dy * static_cast<std::ptrdiff_t>(numColumns_) + dx;
+
+				if (blocked_[neighbor] != 0) {
+					continue;
+				}
+
+				if (dx != 0 && dy != 0) {
+					// Diagonal moves must not cut the corner of a blocked cell.
+					if (blocked_[cell + dx] != 0 || blocked_[cell + dy * static_cast<std::ptrdiff_t>(numColumns_)] != 0) {
+						continue;
+					}
+
+					costs[numMoves] = cellSize_ * std::sqrt(2.0f);
+				}
+				else {
+					costs[numMoves] = cellSize_;
+				}
+
+				neighbors[numMoves++] = neighbor;
+			}
+		}
+
+		return numMoves;
+	}
+
+	void NavigationGrid::prepare(const Vector2 &waypoint)
+	{
+		const std::size_t goalCell = getCell(waypoint);
+
+		if (goalCell == HRVO_NAVIGATION_GRID_NO_CELL) {
+			return;
+		}
+
+		CachedFlowField &cached = fields_[goalCell];
+		cached.used_ = true;
+
+		if (cached.field_ != NULL) {
+			return;
+		}
+
+		const std::shared_ptr<FlowField> field = std::make_shared<FlowField>();
+		cached.field_ = field;
+		field->distances_.assign(blocked_.size(), std::numeric_limits<float>::infinity());
+		field->parents_.assign(blocked_.size(), HRVO_NAVIGATION_GRID_NO_CELL);
+		field->goalCell_ = goalCell;
+
+		if (blocked_[field->goalCell_] == 0) {
+			CellQueue queue;
+			field->distances_[field->goalCell_] = 0.0f;
+			queue.push(std::make_pair(0.0f, field->goalCell_));
+			propagate(*field, queue);
+		}
+	}
+
+	void NavigationGrid::propagate(FlowField &field, CellQueue &queue) const
+	{
+		std::size_t neighbors[8];
+		float costs[8];
+
+		while (!queue.empty()) {
+			const std::pair<float, std::size_t> top = queue.top();
+			queue.pop();
+
+			if (top.first > field.distances_[top.second]) {
+				continue;
+			}
+
+			const std::size_t numMoves = getMoves(top.second, neighbors, costs);
+
+			for (std::size_t i = 0; i < numMoves; ++i) {
+				const float dist = top.first + costs[i];
+
+				if (dist < field.distances_[neighbors[i]]) {
+					field.distances_[neighbors[i]] = dist;
+					field.parents_[neighbors[i]] = top.second;
+					queue.push(std::make_pair(dist, neighbors[i]));
+				}
+			}
+		}
+	}
+
+	void NavigationGrid::repairBlocked(FlowField &field, std::size_t cell) const
+	{
+		const std::size_t column = cell % numColumns_;
+		const std::size_t row = cell / numColumns_;
+		std::vector<std::size_t> cleared;
+		std::size_t neighbors[8];
+		float costs[8];
+
+		// The paths through the blocked cell and the diagonal moves across its corners are no longer open.
+		for (std::size_t y = (row > 0 ? row - 1 : 0); y <= row + 1 && y < numRows_; ++y) {
+			for (std::size_t x = (column > 0 ? column - 1 : 0); x <= column + 1 && x < numColumns_; ++x) {
+				const std::size_t neighbor = y * numColumns_ + x;
+				const std::size_t parent = field.parents_[neighbor];
+				bool open = neighbor != cell;
+
+				if (open && parent != HRVO_NAVIGATION_GRID_NO_CELL) {
+					const std::size_t numMoves = getMoves(neighbor, neighbors, costs);
+					open = false;
+
+					for (std::size_t i = 0; i < numMoves && !open; ++i) {
+						open = neighbors[i] == parent;
+					}
+				}
+
+				if (!open && !std::isinf(field.distances_[neighbor])) {
+					field.distances_[neighbor] = std::numeric_limits<float>::infinity();
+					field.parents_[neighbor] = HRVO_NAVIGATION_GRID_NO_CELL;
+					cleared.push_back(neighbor);
+				}
+			}
+		}
+
+		// Every path that continued from a cleared cell is cleared in turn.
+		for (std::size_t i = 0; i < cleared.size(); ++i) {
+			const std::size_t clearedColumn = cleared[i] % numColumns_;
+			const std::size_t clearedRow = cleared[i] / numColumns_;
+
+			for (std::size_t y = (clearedRow > 0 ? clearedRow - 1 : 0); y <= clearedRow + 1 && y < numRows_; ++y) {
+				for (std::size_t x = (clearedColumn > 0 ? clearedColumn - 1 : 0); x <= clearedColumn + 1 && x < numColumns_; ++x) {
+					const std::size_t child = y * numColumns_ + x;
+
+					if (field.parents_[child] == cleared[i]) {
+						field.distances_[child] = std::numeric_limits<float>::infinity();
+						field.parents_[child] = HRVO_NAVIGATION_GRID_NO_CELL;
+						cleared.push_back(child);
+					}
+				}
+			}
+		}
+
+		// The cleared cells are reached again from the unaffected paths around them.
+		CellQueue queue;
+
+		for (std::vector<std::size_t>::const_iterator iter = cleared.begin(); iter != cleared.end(); ++iter) {
+			if (blocked_[*iter] != 0) {
+				continue;
+			}
+
+			const std::size_t numMoves = getMoves(*iter, neighbors, costs);
+
+			for (std::size_t i = 0; i < numMoves; ++i) {
+				const float dist = field.distances_[neighbors[i]] + costs[i];
+
+				if (dist < field.distances_[*iter]) {
+					field.distances_[*iter] = dist;
+					field.parents_[*iter] = neighbors[i];
+				}
+			}
+
+			if (!std::isinf(field.distances_[*iter])) {
+				queue.push(std::make_pair(field.distances_[*iter], *iter));
+			}
+		}
+
+		propagate(field, queue);
+	}
+
+	void NavigationGrid::repairFreed(FlowField &field, std::size_t cell) const
+	{
+		const std::size_t column = cell % numColumns_;
+		const std::size_t row = cell / numColumns_;
+		CellQueue queue;
+
+		if (cell == field.goalCell_) {
+			field.distances_[cell] = 0.0f;
+		}
+
+		// Every move opened by the freed cell starts or ends within one cell of it.
+		for (std::size_t y = (row > 0 ? row - 1 : 0); y <= row + 1 && y < numRows_; ++y) {
+			for (std::size_t x = (column > 0 ? column - 1 : 0); x <= column + 1 && x < numColumns_; ++x) {
+				const std::size_t neighbor = y * numColumns_ + x;
+
+				if (!std::isinf(field.distances_[neighbor])) {
+					queue.push(std::make_pair(field.distances_[neighbor], neighbor));
+				}
+			}
+		}
+
+		propagate(field, queue);
+	}
+
+	void NavigationGrid::setCellBlocked(const Vector2 &position, bool blocked)
+	{
+		const std::size_t cell = getCell(position);
+
+		if (cell == HRVO_NAVIGATION_GRID_NO_CELL || (blocked_[cell] != 0) == blocked) {
+			return;
+		}
+
+		blocked_[cell] = blocked ? 1 : 0;
+
+		// Only the flow fields of goal cells that agents head to are cached, so no field repaired here is stale.
+		for (std::map<std::size_t, CachedFlowField>::iterator iter = fields_.begin(); iter != fields_.end(); ++iter) {
+			// Flow fields shared with a clone are copied before they are repaired.
+			if (iter->second.field_.use_count() > 1) {
+				iter->second.field_ = std::make_shared<FlowField>(*iter->second.field_);
+			}
+
+			if (blocked) {
+				repairBlocked(*iter->second.field_, cell);
+			}
+			else {
+				repairFreed(*iter->second.field_, cell);
+			}
+		}
+	}
+}
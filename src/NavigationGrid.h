@@ -0,0 +1,219 @@
+/*
+ * NavigationGrid.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   NavigationGrid.h
+ * \brief  Declares the NavigationGrid class.
+ */
+
+#ifndef HRVO_NAVIGATION_GRID_H_
+#define HRVO_NAVIGATION_GRID_H_
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "Vector2.h"
+
+namespace hrvo {
+	/**
+	 * \class    NavigationGrid
+	 * \brief    A grid of free and blocked cells over which agents follow flow fields around static obstacles to their waypoints.
+	 *
+	 * \details  The flow field of a goal cell holds the length of the shortest
+	 *           path from each cell to the goal cell and the next cell on that
+	 *           path. It is computed once and shared by every agent heading
+	 *           to a waypoint in that cell, shared with copies of the grid
+	 *           until either modifies it, repaired rather than recomputed when
+	 *           a cell is blocked or freed, and dropped once no agent heads to
+	 *           that cell.
+	 */
+	class NavigationGrid {
+	private:
+		/**
+		 * \class  FlowField
+		 * \brief  The shortest paths from every cell of the grid to a goal cell.
+		 */
+		class FlowField {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			FlowField() : goalCell_(0) { }
+
+			/**
+			 * \brief  The length of the shortest path from the center of each cell to the goal cell, or infinity if there is none.
+			 */
+			std::vector<float> distances_;
+
+			/**
+			 * \brief  The next cell on the shortest path from each cell, or HRVO_NAVIGATION_GRID_NO_CELL if there is none.
+			 */
+			std::vector<std::size_t> parents_;
+
+			/**
+			 * \brief  The goal cell.
+			 */
+			std::size_t goalCell_;
+		};
+
+		/**
+		 * \class  CachedFlowField
+		 * \brief  A flow field cached by the grid.
+		 */
+		class CachedFlowField {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			CachedFlowField() : used_(false) { }
+
+			/**
+			 * \brief  The flow field, which may be shared with copies of the grid.
+			 */
+			std::shared_ptr<FlowField> field_;
+
+			/**
+			 * \brief  Whether an agent has headed to the goal cell since unused flow fields were last evicted.
+			 */
+			bool used_;
+		};
+
+		/**
+		 * \brief  A queue of cells ordered by increasing path length.
+		 */
+		typedef std::priority_queue<std::pair<float, std::size_t>, std::vector<std::pair<float, std::size_t> >, std::greater<std::pair<float, std::size_t> > > CellQueue;
+
+		/**
+		 * \brief  The number of a cell that does not exist.
+		 */
+		static const std::size_t HRVO_NAVIGATION_GRID_NO_CELL = std::numeric_limits<std::size_t>::max();
+
+		/**
+		 * \brief      Constructor.
+		 * \param[in]  origin      The position of the corner of the grid with the smallest coordinates.
+		 * \param[in]  numColumns  The number of columns of cells, along the x-axis.
+		 * \param[in]  numRows     The number of rows of cells, along the y-axis.
+		 * \param[in]  cellSize    The width of a cell.
+		 */
+		NavigationGrid(const Vector2 &origin, std::size_t numColumns, std::size_t numRows, float cellSize);
+
+		/**
+		 * \brief  Drops the flow fields of the goal cells to which no agent has headed since this was last called.
+		 */
+		void evictUnused();
+
+		/**
+		 * \brief      Returns the cell that contains a position.
+		 * \param[in]  position  The position.
+		 * \return     The number of the cell, or HRVO_NAVIGATION_GRID_NO_CELL if the position lies outside the grid.
+		 */
+		std::size_t getCell(const Vector2 &position) const;
+
+		/**
+		 * \brief      Returns whether the cell that contains a position is blocked.
+		 * \param[in]  position  The position.
+		 * \return     True if the cell is blocked; false if it is free or the position lies outside the grid.
+		 */
+		bool getCellBlocked(const Vector2 &position) const;
+
+		/**
+		 * \brief          Follows the flow field of the cell of a waypoint from a position, interpolating bilinearly between the four nearest cell centers.
+		 * \param[in]      waypoint   The position of the waypoint.
+		 * \param[in]      position   The position.
+		 * \param[out]     direction  The unit direction of the path to the waypoint.
+		 * \param[out]     dist       The length of the path to the waypoint.
+		 * \return         True if the flow field leads to the waypoint; false if the waypoint should be approached directly, because it is in a neighboring cell, there is no path, or the position or waypoint lies outside the grid.
+		 */
+		bool getFlow(const Vector2 &waypoint, const Vector2 &position, Vector2 &direction, float &dist) const;
+
+		/**
+		 * \brief      Returns the open moves from a cell to its eight neighbors; a diagonal move must not cut the corner of a blocked cell.
+		 * \param[in]  cell       The number of the cell.
+		 * \param[out] neighbors  The numbers of the neighbors that may be moved to.
+		 * \param[out] costs      The lengths of the moves.
+		 * \return     The number of open moves.
+		 */
+		std::size_t getMoves(std::size_t cell, std::size_t neighbors[8], float costs[8]) const;
+
+		/**
+		 * \brief      Computes the flow field of the cell of a waypoint if it is not cached, and keeps it from eviction; does nothing if the waypoint lies outside the grid.
+		 * \param[in]  waypoint  The position of the waypoint.
+		 */
+		void prepare(const Vector2 &waypoint);
+
+		/**
+		 * \brief          Extends the shortest paths of a flow field from the queued cells until no path can be shortened.
+		 * \param[in,out]  field  The flow field.
+		 * \param[in,out]  queue  The cells whose paths have been shortened.
+		 */
+		void propagate(FlowField &field, CellQueue &queue) const;
+
+		/**
+		 * \brief          Repairs a flow field after a cell has been blocked by clearing the paths through it and extending the remaining paths into the cleared cells.
+		 * \param[in,out]  field  The flow field.
+		 * \param[in]      cell   The number of the blocked cell.
+		 */
+		void repairBlocked(FlowField &field, std::size_t cell) const;
+
+		/**
+		 * \brief          Repairs a flow field after a cell has been freed by extending the paths into and through it.
+		 * \param[in,out]  field  The flow field.
+		 * \param[in]      cell   The number of the freed cell.
+		 */
+		void repairFreed(FlowField &field, std::size_t cell) const;
+
+		/**
+		 * \brief      Blocks or frees the cell that contains a position and repairs every cached flow field.
+		 * \param[in]  position  The position.
+		 * \param[in]  blocked   Whether the cell is blocked.
+		 */
+		void setCellBlocked(const Vector2 &position, bool blocked);
+
+		std::map<std::size_t, CachedFlowField> fields_;
+		std::vector<char> blocked_;
+		Vector2 origin_;
+		std::size_t numColumns_;
+		std::size_t numRows_;
+		float cellSize_;
+
+		friend class Agent;
+		friend class Simulator;
+	};
+}
+
+#endif /* HRVO_NAVIGATION_GRID_H_ */
@@ -0,0 +1,151 @@
+/*
+ * NeighborTuner.cpp
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   NeighborTuner.cpp
+ * \brief  Defines the NeighborTuner class.
+ */
+
+#include "NeighborTuner.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Agent.h"
+#include "Simulator.h"
+
+namespace hrvo {
+	const float NeighborTuner::HRVO_TUNER_AGENT_TOLERANCE = 0.25f;
+	const float NeighborTuner::HRVO_TUNER_DENSITY_TOLERANCE = 2.0f;
+
+	NeighborTuner::NeighborTuner(Simulator *simulator) : simulator_(simulator), bruteForceThreshold_(simulator->kdTree_->bruteForceThreshold_), configuration_(0), maxLeafSize_(simulator->kdTree_->maxLeafSize_), numAgents_(0), step_(0), splitRule_(simulator->kdTree_->splitRule_), density_(0.0f), tuned_(false)
+	{
+		configurations_.push_back(Configuration(true, KdTree::HRVO_MAX_LEAF_SIZE, KdTree::SPLIT_MIDPOINT));
+
+		for (std::size_t maxLeafSize = 4; maxLeafSize <= 32; maxLeafSize *= 2) {
+			configurations_.push_back(Configuration(false, maxLeafSize, KdTree::SPLIT_MIDPOINT));
+			configurations_.push_back(Configuration(false, maxLeafSize, KdTree::SPLIT_MEDIAN));
+		}
+	}
+
+	void NeighborTuner::beginStep()
+	{
+		if (tuned_) {
+			const float density = computeDensity();
+
+			if (static_cast<float>(simulator_->agents_.size()) > (1.0f + HRVO_TUNER_AGENT_TOLERANCE) * static_cast<float>(numAgents_)
+				|| static_cast<float>(simulator_->agents_.size()) < (1.0f - HRVO_TUNER_AGENT_TOLERANCE) * static_cast<float>(numAgents_)
+				|| density > HRVO_TUNER_DENSITY_TOLERANCE * density_ || density * HRVO_TUNER_DENSITY_TOLERANCE < density_) {
+				restart();
+			}
+		}
+
+		const Configuration &configuration = configurations_[configuration_];
+		KdTree *const kdTree = simulator_->kdTree_;
+
+		kdTree->bruteForceThreshold_ = configuration.bruteForce_ ? std::numeric_limits<std::size_t>::max() : 0;
+		kdTree->maxLeafSize_ = configuration.maxLeafSize_;
+		kdTree->splitRule_ = configuration.splitRule_;
+	}
+
+	float NeighborTuner::computeDensity() const
+	{
+		if (simulator_->agents_.empty()) {
+			return 0.0f;
+		}
+
+		float minX = simulator_->agents_.front()->position_.getX();
+		float maxX = minX;
+		float minY = simulator_->agents_.front()->position_.getY();
+		float maxY = minY;
+
+		for (std::vector<Agent *>::const_iterator iter = simulator_->agents_.begin(); iter != simulator_->agents_.end(); ++iter) {
+			minX = std::min(minX, (*iter)->position_.getX());
+			maxX = std::max(maxX, (*iter)->position_.getX());
+			minY = std::min(minY, (*iter)->position_.getY());
+			maxY = std::max(maxY, (*iter)->position_.getY());
+		}
+
+		return static_cast<float>(simulator_->agents_.size()) / std::max((maxX - minX) * (maxY - minY), std::numeric_limits<float>::min());
+	}
+
+	void NeighborTuner::endStep(double time)
+	{
+		if (tuned_) {
+			return;
+		}
+
+		Configuration &configuration = configurations_[configuration_];
+
+		if (step_ == 0 || time < configuration.time_) {
+			configuration.time_ = time;
+		}
+
+		if (++step_ < HRVO_TUNER_TRIAL_STEPS) {
+			return;
+		}
+
+		step_ = 0;
+
+		if (++configuration_ < configurations_.size()) {
+			return;
+		}
+
+		configuration_ = 0;
+
+		for (std::size_t i = 1; i < configurations_.size(); ++i) {
+			if (configurations_[i].time_ < configurations_[configuration_].time_) {
+				configuration_ = i;
+			}
+		}
+
+		numAgents_ = simulator_->agents_.size();
+		density_ = computeDensity();
+		tuned_ = true;
+	}
+
+	void NeighborTuner::restart()
+	{
+		configuration_ = 0;
+		step_ = 0;
+		tuned_ = false;
+	}
+
+	void NeighborTuner::restore()
+	{
+		KdTree *const kdTree = simulator_->kdTree_;
+
+		kdTree->bruteForceThreshold_ = bruteForceThreshold_;
+		kdTree->maxLeafSize_ = maxLeafSize_;
+		kdTree->splitRule_ = splitRule_;
+	}
+}
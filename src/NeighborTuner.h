@@ -0,0 +1,153 @@
+/*
+ * NeighborTuner.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   NeighborTuner.h
+ * \brief  Declares the NeighborTuner class.
+ */
+
+#ifndef HRVO_NEIGHBOR_TUNER_H_
+#define HRVO_NEIGHBOR_TUNER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "KdTree.h"
+
+namespace hrvo {
+	class Simulator;
+
+	/**
+	 * \class  NeighborTuner
+	 * \brief  Chooses the fastest neighbor index configuration by timing candidate configurations on the live simulation.
+	 */
+	class NeighborTuner {
+	private:
+		/**
+		 * \class  Configuration
+		 * \brief  A candidate neighbor index configuration.
+		 */
+		class Configuration {
+		public:
+			/**
+			 * \brief      Constructor.
+			 * \param[in]  bruteForce   Whether neighbors are computed by brute force.
+			 * \param[in]  maxLeafSize  The maximum leaf size of the k-D tree.
+			 * \param[in]  splitRule    The split rule of the k-D tree.
+			 */
+			Configuration(bool bruteForce, std::size_t maxLeafSize, KdTree::SplitRule splitRule) : maxLeafSize_(maxLeafSize), time_(0.0), splitRule_(splitRule), bruteForce_(bruteForce) { }
+
+			/**
+			 * \brief  The maximum leaf size of the k-D tree.
+			 */
+			std::size_t maxLeafSize_;
+
+			/**
+			 * \brief  The fastest time, in seconds, measured for this configuration.
+			 */
+			double time_;
+
+			/**
+			 * \brief  The split rule of the k-D tree.
+			 */
+			KdTree::SplitRule splitRule_;
+
+			/**
+			 * \brief  Whether neighbors are computed by brute force.
+			 */
+			bool bruteForce_;
+		};
+
+		/**
+		 * \brief  The number of steps for which each candidate configuration is timed.
+		 */
+		static const std::size_t HRVO_TUNER_TRIAL_STEPS = 3;
+
+		/**
+		 * \brief  The relative change in agent count that triggers retuning.
+		 */
+		static const float HRVO_TUNER_AGENT_TOLERANCE;
+
+		/**
+		 * \brief  The factor by which the agent density must change to trigger retuning.
+		 */
+		static const float HRVO_TUNER_DENSITY_TOLERANCE;
+
+		/**
+		 * \brief      Constructor that saves the present configuration of the k-D tree, which is restored once tuning is disabled.
+		 * \param[in]  simulator  The simulation.
+		 */
+		explicit NeighborTuner(Simulator *simulator);
+
+		/**
+		 * \brief  Applies the configuration under trial, or the fastest configuration once tuning is complete, to the k-D tree; restarts tuning if the agent count or density has changed significantly.
+		 */
+		void beginStep();
+
+		/**
+		 * \brief      Records the time taken to compute the neighbors of all agents with the configuration applied by beginStep().
+		 * \param[in]  time  The time, in seconds, taken to build the neighbor index and compute the neighbors of all agents.
+		 */
+		void endStep(double time);
+
+		/**
+		 * \brief   Computes the number of agents per unit area of the bounding box of all agents.
+		 * \return  The density of agents.
+		 */
+		float computeDensity() const;
+
+		/**
+		 * \brief  Restarts tuning from the first candidate configuration.
+		 */
+		void restart();
+
+		/**
+		 * \brief  Restores the configuration of the k-D tree set before tuning began.
+		 */
+		void restore();
+
+		Simulator *const simulator_;
+		std::vector<Configuration> configurations_;
+		std::size_t bruteForceThreshold_;
+		std::size_t configuration_;
+		std::size_t maxLeafSize_;
+		std::size_t numAgents_;
+		std::size_t step_;
+		KdTree::SplitRule splitRule_;
+		float density_;
+		bool tuned_;
+
+		friend class Simulator;
+	};
+}
+
+#endif /* HRVO_NEIGHBOR_TUNER_H_ */
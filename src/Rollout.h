@@ -0,0 +1,113 @@
+/*
+ * Rollout.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   Rollout.h
+ * \brief  Declares the Rollout class.
+ */
+
+#ifndef HRVO_ROLLOUT_H_
+#define HRVO_ROLLOUT_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "Export.h"
+
+namespace hrvo {
+	class Simulator;
+
+	/**
+	 * \class    Rollout
+	 * \brief    A prediction of the simulation with alternative goals, run on a clone by Simulator::runRollouts().
+	 *
+	 * \details  The goals of the rollout are assigned before it is run, and
+	 *           its summary metrics are read after.
+	 */
+	class HRVO_EXPORT Rollout {
+	public:
+		/**
+		 * \brief  Constructor.
+		 */
+		Rollout();
+
+		/**
+		 * \brief   Returns the global time at the end of the rollout.
+		 * \return  The global time at the end of the rollout.
+		 */
+		float getGlobalTime() const { return globalTime_; }
+
+		/**
+		 * \brief   Returns the smallest distance between the edges of neighboring agents during the rollout.
+		 * \return  The smallest clearance, which is negative if agents overlapped.
+		 */
+		float getMinClearance() const { return minClearance_; }
+
+		/**
+		 * \brief   Returns the count of agents that had reached their goals at the end of the rollout.
+		 * \return  The count of agents that had reached their goals.
+		 */
+		std::size_t getNumReachedGoals() const { return numReachedGoals_; }
+
+		/**
+		 * \brief   Returns the sum of the distances from each agent to its goal at the end of the rollout.
+		 * \return  The sum of the distances to the goals.
+		 */
+		float getTotalDistToGoals() const { return totalDistToGoals_; }
+
+		/**
+		 * \brief   Returns whether all agents had reached their goals at the end of the rollout.
+		 * \return  True if all agents had reached their goals; false otherwise.
+		 */
+		bool haveReachedGoals() const { return reachedGoals_; }
+
+		/**
+		 * \brief      Assigns a goal to an agent for the rollout.
+		 * \param[in]  agentNo  The number of the agent.
+		 * \param[in]  goalNo   The number of a goal of the simulation.
+		 */
+		void setAgentGoal(std::size_t agentNo, std::size_t goalNo) { agentGoals_.push_back(std::make_pair(agentNo, goalNo)); }
+
+	private:
+		std::vector<std::pair<std::size_t, std::size_t> > agentGoals_;
+		std::size_t numReachedGoals_;
+		float globalTime_;
+		float minClearance_;
+		float totalDistToGoals_;
+		bool reachedGoals_;
+
+		friend class Simulator;
+	};
+}
+
+#endif /* HRVO_ROLLOUT_H_ */
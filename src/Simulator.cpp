@@ -37,32 +37,57 @@
 
 #include "Simulator.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <stdexcept>
+#include <string>
+#include <thread>
 
 #include "Agent.h"
+#include "AgentParameters.h"
+#include "Definitions.h"
 #include "Goal.h"
 #include "KdTree.h"
+#include "NavigationGrid.h"
+#include "NeighborTuner.h"
+#include "Rollout.h"
+#include "Snapshot.h"
+#include "StateBuffer.h"
+#include "ThreadPool.h"
+#include "Trajectory.h"
 
 namespace hrvo {
-	Simulator::Simulator() : defaults_(NULL), kdTree_(NULL), globalTime_(0.0f), timeStep_(0.0f), reachedGoals_(false)
+	const std::size_t Simulator::HRVO_NO_AGENT_PROFILE;
+	const std::size_t Simulator::HRVO_NO_GOAL;
+	const std::size_t Simulator::HRVO_NO_PARAMETERS;
+
+	Simulator::Simulator() : kdTree_(NULL), navigationGrid_(NULL), neighborTuner_(NULL), stateBuffer_(NULL), threadPool_(NULL), globalTime_(0.0f), maxDecisionInterval_(0.0f), minDecisionInterval_(0.0f), minSubStep_(0.0f), overlapTolerance_(0.0f), timeStep_(0.0f), defaultsNo_(HRVO_NO_PARAMETERS), kinematicsChanged_(true), reachedGoals_(false), parameters_(std::make_shared<std::vector<AgentParameters> >()), waypoints_(std::make_shared<std::vector<Vector2> >())
 	{
 		kdTree_ = new KdTree(this);
+		stateBuffer_ = new StateBuffer(this);
+		threadPool_ = new ThreadPool(1);
 	}
 
 	Simulator::~Simulator()
 	{
-		delete defaults_;
-		defaults_ = NULL;
+		// Completes any step running in the background before its state is destroyed.
+		delete threadPool_;
+		threadPool_ = NULL;
 
 		delete kdTree_;
 		kdTree_ = NULL;
 
-		for (std::vector<Agent *>::iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
-			delete *iter;
-			*iter = NULL;
-		}
+		delete navigationGrid_;
+		navigationGrid_ = NULL;
+
+		delete neighborTuner_;
+		neighborTuner_ = NULL;
 
-		for (std::vector<Goal *>::iterator iter = goals_.begin(); iter != goals_.end(); ++iter) {
+		delete stateBuffer_;
+		stateBuffer_ = NULL;
+
+		for (std::vector<Agent *>::iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
 			delete *iter;
 			*iter = NULL;
 		}
@@ -70,50 +95,354 @@ namespace hrvo {
 
 	std::size_t Simulator::addAgent(const Vector2 &position, std::size_t goalNo)
 	{
-		if (defaults_ == NULL) {
+		if (defaultsNo_ == HRVO_NO_PARAMETERS) {
 			throw std::runtime_error("Agent defaults not set when adding agent.");
 		}
 
-		Agent *const agent = new Agent(this, position, goalNo);
-		agents_.push_back(agent);
+		if (goalNo >= goals_.size()) {
+			throw std::runtime_error("Goal not found when adding agent.");
+		}
+
+		const std::size_t agentNo = insertAgent(new Agent(this, position, goalNo, HRVO_NO_AGENT_PROFILE, defaultsNo_));
+		stateBuffer_->publish();
+
+		return agentNo;
+	}
+
+	std::size_t Simulator::addAgent(const Vector2 &position, std::size_t goalNo, std::size_t profileNo)
+	{
+		if (profileNo >= profiles_.size()) {
+			throw std::runtime_error("Agent profile not found when adding agent.");
+		}
+
+		if (goalNo >= goals_.size()) {
+			throw std::runtime_error("Goal not found when adding agent.");
+		}
+
+		const std::size_t agentNo = insertAgent(new Agent(this, position, goalNo, profileNo, profiles_[profileNo]));
+		stateBuffer_->publish();
 
-		return agents_.size() - 1;
+		return agentNo;
 	}
 
-	std::size_t Simulator::addAgent(const Vector2 &position, std::size_t goalNo, float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed,
-#if HRVO_DIFFERENTIAL_DRIVE
-		float timeToOrientation, float wheelTrack,
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-		float uncertaintyOffset, float maxAccel, const Vector2 &velocity, float orientation)
+	std::size_t Simulator::addAgent(const Vector2 &position, std::size_t goalNo, float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset, float maxAccel, const Vector2 &velocity, float orientation, float timeHorizon)
 	{
-		Agent *const agent = new Agent(this, position, goalNo, neighborDist, maxNeighbors, radius, velocity, maxAccel, goalRadius, prefSpeed, maxSpeed, orientation,
-#if HRVO_DIFFERENTIAL_DRIVE
-			timeToOrientation, wheelTrack,
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-			uncertaintyOffset);
-		agents_.push_back(agent);
+		if (goalNo >= goals_.size()) {
+			throw std::runtime_error("Goal not found when adding agent.");
+		}
 
-		return agents_.size() - 1;
+		// An agent added with individual properties is the only user of its parameters.
+		const std::size_t agentNo = insertAgent(new Agent(this, position, goalNo, HRVO_NO_AGENT_PROFILE, addParameters(AgentParameters(neighborDist, maxNeighbors, radius, goalRadius, prefSpeed, maxSpeed, uncertaintyOffset, maxAccel, velocity, orientation, timeHorizon, std::numeric_limits<float>::infinity()))));
+		stateBuffer_->publish();
+
+		return agentNo;
+	}
+
+	void Simulator::addAgents(const Vector2 *positions, const std::size_t *goalNos, std::size_t numAgents, std::size_t *agentNos)
+	{
+		addAgents(positions, goalNos, NULL, numAgents, agentNos);
+	}
+
+	void Simulator::addAgents(const Vector2 *positions, const std::size_t *goalNos, const std::size_t *profileNos, std::size_t numAgents, std::size_t *agentNos)
+	{
+		for (std::size_t i = 0; i < numAgents; ++i) {
+			const std::size_t profileNo = profileNos != NULL ? profileNos[i] : HRVO_NO_AGENT_PROFILE;
+
+			if (profileNo == HRVO_NO_AGENT_PROFILE) {
+				if (defaultsNo_ == HRVO_NO_PARAMETERS) {
+					throw std::runtime_error("Agent defaults not set when adding agents.");
+				}
+			}
+			else if (profileNo >= profiles_.size()) {
+				throw std::runtime_error("Agent profile not found when adding agents.");
+			}
+
+			if (goalNos[i] >= goals_.size()) {
+				throw std::runtime_error("Goal not found when adding agents.");
+			}
+		}
+
+		// Agents reuse the numbers of removed agents first, so only the remainder grows the agent list.
+		if (numAgents > freeAgentNos_.size()) {
+			agents_.reserve(agents_.size() + numAgents - freeAgentNos_.size());
+		}
+
+		for (std::size_t i = 0; i < numAgents; ++i) {
+			const std::size_t profileNo = profileNos != NULL ? profileNos[i] : HRVO_NO_AGENT_PROFILE;
+			const std::size_t agentNo = insertAgent(new Agent(this, positions[i], goalNos[i], profileNo, profileNo != HRVO_NO_AGENT_PROFILE ? profiles_[profileNo] : defaultsNo_));
+
+			if (agentNos != NULL) {
+				agentNos[i] = agentNo;
+			}
+		}
+
+		stateBuffer_->publish();
+	}
+
+	std::size_t Simulator::addAgentProfile(const std::string &name, float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset, float maxAccel, const Vector2 &velocity, float orientation, float timeHorizon, float clusterDist)
+	{
+		if (std::find(profileNames_.begin(), profileNames_.end(), name) != profileNames_.end()) {
+			throw std::runtime_error("Agent profile already exists when adding agent profile.");
+		}
+
+		const std::size_t parametersNo = addParameters(AgentParameters(neighborDist, maxNeighbors, radius, goalRadius, prefSpeed, maxSpeed, uncertaintyOffset, maxAccel, velocity, orientation, timeHorizon, clusterDist));
+		++numParametersUsers_[parametersNo];
+
+		profiles_.push_back(parametersNo);
+		profileNames_.push_back(name);
+
+		return profiles_.size() - 1;
 	}
 
 	std::size_t Simulator::addGoal(const Vector2 &position)
 	{
-		Goal *const goal = new Goal(position);
-		goals_.push_back(goal);
+		return addGoalPositions(std::vector<Vector2>(1, position));
+	}
+
+	std::size_t Simulator::addGoalPositions(const std::vector<Vector2> &positions)
+	{
+		if (positions.empty()) {
+			throw std::runtime_error("Goal has no positions.");
+		}
+
+		std::vector<Vector2> &waypoints = writeWaypoints();
+		goals_.push_back(Goal(waypoints.size(), waypoints.size() + positions.size()));
+		waypoints.insert(waypoints.end(), positions.begin(), positions.end());
 
 		return goals_.size() - 1;
 	}
 
-    std::size_t Simulator::addGoalPositions(const std::vector<Vector2> &positions)
-    {
-        Goal *const goal = new Goal(positions);
-        goals_.push_back(goal);
+	std::size_t Simulator::addGoalTrajectory(const Trajectory &trajectory)
+	{
+		if (trajectory.getNumKnots() == 0) {
+			throw std::runtime_error("Goal trajectory has no knots.");
+		}
 
-        return goals_.size() - 1;
-    }
+		// The route of the goal is the final position of the trajectory, which agents hold once it has ended.
+		const std::size_t goalNo = addGoal(trajectory.positions_.back());
+		goals_[goalNo].trajectory_ = std::make_shared<const Trajectory>(trajectory);
+
+		return goalNo;
+	}
+
+	std::size_t Simulator::addParameters(const AgentParameters &parameters)
+	{
+		if (freeParametersNos_.empty()) {
+			writeParameterTable().push_back(parameters);
+			numParametersUsers_.push_back(0);
+
+			return parameters_->size() - 1;
+		}
+
+		const std::size_t parametersNo = freeParametersNos_.back();
+		freeParametersNos_.pop_back();
+
+		writeParameters(parametersNo) = parameters;
+
+		return parametersNo;
+	}
+
+	void Simulator::applyProfile(std::size_t profileNo)
+	{
+		// Agents that share the parameters of the profile see any change to them; only those with parameters of their own are updated.
+		const AgentParameters profile = (*parameters_)[profiles_[profileNo]];
+
+		for (std::vector<Agent *>::const_iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
+			if ((*iter)->profileNo_ == profileNo && (*iter)->parametersNo_ != profiles_[profileNo]) {
+				writeParameters((*iter)->parametersNo_).applyProfile(profile, (*iter)->overrides_);
+			}
+		}
+	}
+
+	void Simulator::advanceTime(float timeStep)
+	{
+		if (threadPool_->isTaskPending()) {
+			throw std::runtime_error("Asynchronous step in progress when attempting to advance time.");
+		}
+
+		// Each agent owns its cursor along the route of its goal, so progress is made in parallel.
+		threadPool_->parallelFor(agents_.size(), [this](std::size_t agentNo) {
+			agents_[agentNo]->updateGoal();
+		});
+
+		finishStep(timeStep);
+	}
+
+	void Simulator::buildIndex()
+	{
+		if (threadPool_->isTaskPending()) {
+			throw std::runtime_error("Asynchronous step in progress when attempting to build index.");
+		}
+
+		if (neighborTuner_ != NULL) {
+			neighborTuner_->beginStep();
+		}
+
+		const std::chrono::steady_clock::time_point neighborStart = std::chrono::steady_clock::now();
+
+		kdTree_->build();
+
+		// Each parallel loop writes only the state of its own agent, so the trajectories do not depend on the number of threads.
+		// Visit agents in k-D tree leaf order so that consecutive queries touch the same nodes.
+		threadPool_->parallelFor(kdTree_->agents_.size(), [this](std::size_t i) {
+			Agent *const agent = agents_[kdTree_->agents_[i]];
+
+			if (agent->isDecisionDue()) {
+				agent->computeNeighbors();
+			}
+		});
+
+		if (neighborTuner_ != NULL) {
+			neighborTuner_->endStep(std::chrono::duration<double>(std::chrono::steady_clock::now() - neighborStart).count());
+		}
+	}
+
+	void Simulator::checkDifferentialDrive(const AgentParameters &parameters, const char *action)
+	{
+		// A differential-drive agent divides by its time to orientation and wheel track.
+		if (parameters.kinematics_ == KINEMATICS_DIFFERENTIAL_DRIVE && (parameters.timeToOrientation_ <= 0.0f || parameters.wheelTrack_ <= 0.0f)) {
+			throw std::runtime_error(std::string("Time to orientation or wheel track not positive when ") + action + ".");
+		}
+	}
+
+	Simulator *Simulator::clone() const
+	{
+		Simulator *const simulator = new Simulator();
+
+		simulator->agents_.reserve(agents_.size());
+
+		// Each agent copies only its own state; its parameters stay in the shared parameter table.
+		for (std::vector<Agent *>::const_iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
+			simulator->agents_.push_back(new Agent(simulator, **iter));
+		}
+
+		simulator->defaultsNo_ = defaultsNo_;
+		simulator->freeAgentNos_ = freeAgentNos_;
+		simulator->freeParametersNos_ = freeParametersNos_;
+		simulator->goals_ = goals_;
+		simulator->numParametersUsers_ = numParametersUsers_;
+		simulator->parameters_ = parameters_;
+		simulator->positionGoalNos_ = positionGoalNos_;
+		simulator->profileNames_ = profileNames_;
+		simulator->profiles_ = profiles_;
+		simulator->waypoints_ = waypoints_;
+
+		simulator->kdTree_->bruteForceThreshold_ = kdTree_->bruteForceThreshold_;
+		simulator->kdTree_->maxLeafSize_ = kdTree_->maxLeafSize_;
+		simulator->kdTree_->splitRule_ = kdTree_->splitRule_;
+		simulator->kdTree_->bruteForce_ = kdTree_->bruteForce_;
+		simulator->kdTree_->surfaceDistance_ = kdTree_->surfaceDistance_;
+
+		// Flow fields are shared with the clone until either simulator repairs them.
+		if (navigationGrid_ != NULL) {
+			simulator->navigationGrid_ = new NavigationGrid(*navigationGrid_);
+		}
+
+		simulator->globalTime_ = globalTime_;
+		simulator->maxDecisionInterval_ = maxDecisionInterval_;
+		simulator->minDecisionInterval_ = minDecisionInterval_;
+		simulator->minSubStep_ = minSubStep_;
+		simulator->overlapTolerance_ = overlapTolerance_;
+		simulator->timeStep_ = timeStep_;
+		simulator->reachedGoals_ = reachedGoals_;
+
+		simulator->stateBuffer_->invalidate();
+		simulator->stateBuffer_->publish();
+
+		return simulator;
+	}
+
+	float Simulator::computeSubStep(float remainder)
+	{
+		timesToOverlap_.resize(agents_.size());
+
+		threadPool_->parallelFor(agents_.size(), [this](std::size_t agentNo) {
+			timesToOverlap_[agentNo] = agents_[agentNo]->computeTimeToOverlap(overlapTolerance_);
+		});
+
+		const float timeToOverlap = timesToOverlap_.empty() ? remainder : *std::min_element(timesToOverlap_.begin(), timesToOverlap_.end());
+		const float maxSubStep = std::max(timeToOverlap, std::max(minSubStep_, HRVO_EPSILON));
+
+		if (maxSubStep >= remainder) {
+			return remainder;
+		}
+
+		return remainder / std::ceil(remainder / maxSubStep);
+	}
+
+	void Simulator::computeVelocities()
+	{
+		if (threadPool_->isTaskPending()) {
+			throw std::runtime_error("Asynchronous step in progress when attempting to compute velocities.");
+		}
+
+		if (timeStep_ == 0.0f) {
+			throw std::runtime_error("Time step not set when attempting to compute velocities.");
+		}
+
+		// Only agents listed in the k-D tree are visited, so those added or removed since it was built would be skipped or stale.
+		if (kdTree_->agentsChanged_ || kdTree_->numAgents_ != agents_.size()) {
+			throw std::runtime_error("Agents added or removed since building index when attempting to compute velocities.");
+		}
+
+		computeVelocities(timeStep_);
+	}
+
+	void Simulator::computeVelocities(float timeStep)
+	{
+		// Flow fields are shared between agents, so those missing are computed before any agent follows them, and those no agent follows are dropped.
+		if (navigationGrid_ != NULL) {
+			for (std::vector<Agent *>::const_iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
+				if (!(*iter)->removed_ && goals_[(*iter)->goalNo_].trajectory_ == NULL) {
+					navigationGrid_->prepare((*waypoints_)[(*iter)->waypoint_]);
+				}
+			}
+
+			navigationGrid_->evictUnused();
+		}
+
+		// New velocities depend on the preferred velocities of neighbors, so all preferred velocities are computed first.
+		threadPool_->parallelFor(agents_.size(), [this](std::size_t agentNo) {
+			agents_[agentNo]->computePreferredVelocity();
+		});
+
+		float maxSpeed = 0.0f;
+
+		if (maxDecisionInterval_ > 0.0f) {
+			for (std::vector<Agent *>::const_iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
+				if (!(*iter)->removed_) {
+					maxSpeed = std::max(maxSpeed, (*iter)->getParameters().maxSpeed_);
+				}
+			}
+		}
+
+		separating_.assign(kdTree_->agents_.size(), 0);
+
+		// Agents whose decision is not due keep moving towards their last new velocity.
+		threadPool_->parallelFor(kdTree_->agents_.size(), [this, maxSpeed, timeStep](std::size_t i) {
+			Agent *const agent = agents_[kdTree_->agents_[i]];
+
+			if (agent->isDecisionDue()) {
+				agent->computeNewVelocity(timeStep);
+				separating_[i] = agent->hasOverlappingNeighbor();
+
+				if (agent->getParameters().kinematics_ == KINEMATICS_DIFFERENTIAL_DRIVE) {
+					agent->computeWheelSpeeds();
+				}
+
+				if (maxDecisionInterval_ > 0.0f) {
+					agent->nextDecisionTime_ = globalTime_ + agent->computeDecisionInterval(maxSpeed);
+				}
+			}
+		});
+	}
 
 	void Simulator::doStep()
 	{
+		if (threadPool_->isTaskPending()) {
+			throw std::runtime_error("Asynchronous step in progress when attempting to do step.");
+		}
+
 		if (kdTree_ == NULL) {
 			throw std::runtime_error("Simulation not initialized when attempting to do step.");
 		}
@@ -122,24 +451,107 @@ namespace hrvo {
 			throw std::runtime_error("Time step not set when attempting to do step.");
 		}
 
+		subSteps_.clear();
+
+		float remainder = timeStep_;
+
+		while (true) {
+			buildIndex();
+			computeVelocities(remainder);
+
+			const float subStep = overlapTolerance_ > 0.0f ? computeSubStep(remainder) : remainder;
+
+			// The sub-step follows from the new velocities, so agents that separate from overlapping neighbors do so again within it.
+			if (subStep < remainder) {
+				separateOverlaps(subStep);
+			}
+
+			integrate(subStep);
+			subSteps_.push_back(subStep);
+
+			if (subStep == remainder) {
+				break;
+			}
+
+			remainder -= subStep;
+		}
+	}
+
+	std::future<void> Simulator::doStepAsync()
+	{
+		return threadPool_->runAsync([this] { doStep(); });
+	}
+
+	void Simulator::finishStep(float timeStep)
+	{
 		reachedGoals_ = true;
 
-		kdTree_->build();
+		for (std::vector<Agent *>::const_iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
+			if (!(*iter)->reachedGoal_) {
+				reachedGoals_ = false;
+				break;
+			}
+		}
 
-		for (std::vector<Agent *>::iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
-			(*iter)->computePreferredVelocity();
-			(*iter)->computeNeighbors();
-			(*iter)->computeNewVelocity();
-#if HRVO_DIFFERENTIAL_DRIVE
-			(*iter)->computeWheelSpeeds();
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
+		globalTime_ += timeStep;
+
+		stateBuffer_->invalidate();
+		stateBuffer_->publish();
+	}
+
+	std::size_t Simulator::fastForward(std::size_t maxSteps)
+	{
+		if (threadPool_->isTaskPending()) {
+			throw std::runtime_error("Asynchronous step in progress when attempting to fast-forward.");
 		}
 
-		for (std::vector<Agent *>::iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
-			(*iter)->update();
+		if (timeStep_ == 0.0f) {
+			throw std::runtime_error("Time step not set when attempting to fast-forward.");
+		}
+
+		if (maxSteps == 0) {
+			return 0;
+		}
+
+		float maxNeighborDist = 0.0f;
+		float maxSpeed = 0.0f;
+
+		for (std::vector<Agent *>::const_iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
+			maxNeighborDist = std::max(maxNeighborDist, (*iter)->getParameters().neighborDist_);
+			maxSpeed = std::max(maxSpeed, abs((*iter)->velocity_));
 		}
 
-		globalTime_ += timeStep_;
+		kdTree_->build();
+
+		quiescentSteps_.resize(agents_.size());
+
+		threadPool_->parallelFor(agents_.size(), [this, maxSteps, maxSpeed, maxNeighborDist](std::size_t agentNo) {
+			quiescentSteps_[agentNo] = agents_[agentNo]->computeQuiescentSteps(maxSteps, maxSpeed, maxNeighborDist);
+		});
+
+		const std::size_t numSteps = quiescentSteps_.empty() ? maxSteps : *std::min_element(quiescentSteps_.begin(), quiescentSteps_.end());
+
+		if (numSteps == 0) {
+			return 0;
+		}
+
+		const float time = static_cast<float>(numSteps) * timeStep_;
+
+		threadPool_->parallelFor(agents_.size(), [this, time](std::size_t agentNo) {
+			agents_[agentNo]->fastForward(time);
+		});
+
+		globalTime_ += time;
+
+		stateBuffer_->invalidate();
+		stateBuffer_->publish();
+
+		return numSteps;
+	}
+
+	float Simulator::getAgentClusterDist(std::size_t agentNo) const
+	{
+		return agents_[agentNo]->getParameters().clusterDist_;
 	}
 
 	std::size_t Simulator::getAgentGoal(std::size_t agentNo) const
@@ -147,64 +559,125 @@ namespace hrvo {
 		return agents_[agentNo]->goalNo_;
 	}
 
+	AgentHandle Simulator::getAgentHandle(std::size_t agentNo) const
+	{
+		return AgentHandle(agentNo, agents_[agentNo]->generation_);
+	}
+
 	float Simulator::getAgentGoalRadius(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->goalRadius_;
+		return agents_[agentNo]->getParameters().goalRadius_;
 	}
 
-#if HRVO_DIFFERENTIAL_DRIVE
 	float Simulator::getAgentLeftWheelSpeed(std::size_t agentNo) const
 	{
 		return agents_[agentNo]->leftWheelSpeed_;
 	}
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
+
+	Simulator::KinematicModel Simulator::getAgentKinematics(std::size_t agentNo) const
+	{
+		return agents_[agentNo]->getParameters().kinematics_;
+	}
 
 	float Simulator::getAgentMaxAccel(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->maxAccel_;
+		return agents_[agentNo]->getParameters().maxAccel_;
 	}
 
 	std::size_t Simulator::getAgentMaxNeighbors(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->maxNeighbors_;
+		return agents_[agentNo]->getParameters().maxNeighbors_;
 	}
 
 	float Simulator::getAgentMaxSpeed(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->maxSpeed_;
+		return agents_[agentNo]->getParameters().maxSpeed_;
+	}
+
+	std::size_t Simulator::getAgentNo(const AgentHandle &handle) const
+	{
+		if (!hasAgent(handle)) {
+			throw std::runtime_error("Agent not found when getting agent number.");
+		}
+
+		return handle.agentNo_;
 	}
 
 	float Simulator::getAgentNeighborDist(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->neighborDist_;
+		return agents_[agentNo]->getParameters().neighborDist_;
+	}
+
+	Vector2 Simulator::getAgentNewVelocity(std::size_t agentNo) const
+	{
+		return agents_[agentNo]->newVelocity_;
 	}
 
 	float Simulator::getAgentOrientation(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->orientation_;
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		return state->agents_[agentNo].orientation_;
 	}
 
 	Vector2 Simulator::getAgentPosition(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->position_;
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		return state->agents_[agentNo].position_;
+	}
+
+	void Simulator::getAgentPositions(std::size_t agentNo, std::size_t numAgents, Vector2 *positions) const
+	{
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		if (agentNo > state->agents_.size() || numAgents > state->agents_.size() - agentNo) {
+			throw std::runtime_error("Agent not found when getting agent positions.");
+		}
+
+		for (std::size_t i = 0; i < numAgents; ++i) {
+			positions[i] = state->agents_[agentNo + i].position_;
+		}
 	}
 
 	float Simulator::getAgentPrefSpeed(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->prefSpeed_;
+		return agents_[agentNo]->getParameters().prefSpeed_;
+	}
+
+	std::size_t Simulator::getAgentProfile(std::size_t agentNo) const
+	{
+		return agents_[agentNo]->profileNo_;
+	}
+
+	std::size_t Simulator::getAgentProfileNo(const std::string &name) const
+	{
+		const std::vector<std::string>::const_iterator iter = std::find(profileNames_.begin(), profileNames_.end(), name);
+
+		if (iter == profileNames_.end()) {
+			throw std::runtime_error("Agent profile not found when getting agent profile number.");
+		}
+
+		return static_cast<std::size_t>(iter - profileNames_.begin());
 	}
 
 	float Simulator::getAgentRadius(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->radius_;
+		return agents_[agentNo]->getParameters().radius_;
 	}
 
 	bool Simulator::getAgentReachedGoal(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->reachedGoal_;
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		return state->agents_[agentNo].reachedGoal_;
+	}
+
+	float Simulator::getAgentTimeHorizon(std::size_t agentNo) const
+	{
+		return agents_[agentNo]->getParameters().timeHorizon_;
 	}
 
-#if HRVO_DIFFERENTIAL_DRIVE
 	float Simulator::getAgentRightWheelSpeed(std::size_t agentNo) const
 	{
 		return agents_[agentNo]->rightWheelSpeed_;
@@ -212,142 +685,843 @@ namespace hrvo {
 
 	float Simulator::getAgentTimeToOrientation(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->timeToOrientation_;
+		return agents_[agentNo]->getParameters().timeToOrientation_;
 	}
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
 
 	float Simulator::getAgentUncertaintyOffset(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->uncertaintyOffset_;
+		return agents_[agentNo]->getParameters().uncertaintyOffset_;
 	}
 
 	Vector2 Simulator::getAgentVelocity(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->velocity_;
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		return state->agents_[agentNo].velocity_;
+	}
+
+	void Simulator::getAgentVelocities(std::size_t agentNo, std::size_t numAgents, Vector2 *velocities) const
+	{
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		if (agentNo > state->agents_.size() || numAgents > state->agents_.size() - agentNo) {
+			throw std::runtime_error("Agent not found when getting agent velocities.");
+		}
+
+		for (std::size_t i = 0; i < numAgents; ++i) {
+			velocities[i] = state->agents_[agentNo + i].velocity_;
+		}
 	}
 
-#if HRVO_DIFFERENTIAL_DRIVE
 	float Simulator::getAgentWheelTrack(std::size_t agentNo) const
 	{
-		return agents_[agentNo]->wheelTrack_;
+		return agents_[agentNo]->getParameters().wheelTrack_;
+	}
+
+	float Simulator::getGlobalTime() const
+	{
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		return state->globalTime_;
 	}
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
 
 	Vector2 Simulator::getGoalPosition(std::size_t goalNo) const
 	{
-		return goals_[goalNo]->position_;
+		return (*waypoints_)[goals_[goalNo].end_ - 1];
+	}
+
+	bool Simulator::getNavigationGridCellBlocked(const Vector2 &position) const
+	{
+		return navigationGrid_ != NULL && navigationGrid_->getCellBlocked(position);
+	}
+
+	std::size_t Simulator::getNeighborBruteForceThreshold() const
+	{
+		return neighborTuner_ != NULL ? neighborTuner_->bruteForceThreshold_ : kdTree_->bruteForceThreshold_;
+	}
+
+	bool Simulator::getNeighborSurfaceDistance() const
+	{
+		return kdTree_->surfaceDistance_;
+	}
+
+	std::size_t Simulator::getNumAgents() const
+	{
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		return state->agents_.size();
+	}
+
+	std::size_t Simulator::getNumLiveAgents() const
+	{
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		return state->numLiveAgents_;
+	}
+
+	std::size_t Simulator::getNumThreads() const
+	{
+		return threadPool_->getNumThreads();
+	}
+
+	bool Simulator::haveReachedGoals() const
+	{
+		const StateBuffer::Reader state(*stateBuffer_);
+
+		return state->reachedGoals_;
+	}
+
+	bool Simulator::hasAgent(const AgentHandle &handle) const
+	{
+		return handle.agentNo_ < agents_.size() && agents_[handle.agentNo_]->generation_ == handle.generation_ && !agents_[handle.agentNo_]->removed_;
+	}
+
+	void Simulator::groupAgentsByKinematics()
+	{
+		differentialDriveAgents_.clear();
+		holonomicAgents_.clear();
+		omnidirectionalAgents_.clear();
+
+		for (std::size_t agentNo = 0; agentNo < agents_.size(); ++agentNo) {
+			const Agent *const agent = agents_[agentNo];
+
+			// A removed agent stays at rest at its last position until its number is reused.
+			if (agent->removed_) {
+				continue;
+			}
+
+			switch (agent->getParameters().kinematics_) {
+				case KINEMATICS_DIFFERENTIAL_DRIVE:
+					differentialDriveAgents_.push_back(agentNo);
+					break;
+				case KINEMATICS_OMNIDIRECTIONAL:
+					omnidirectionalAgents_.push_back(agentNo);
+					break;
+				default:
+					holonomicAgents_.push_back(agentNo);
+					break;
+			}
+		}
+
+		kinematicsChanged_ = false;
+	}
+
+	std::size_t Simulator::insertAgent(Agent *agent)
+	{
+		++numParametersUsers_[agent->parametersNo_];
+
+		if (freeAgentNos_.empty()) {
+			agents_.push_back(agent);
+			kinematicsChanged_ = true;
+			stateBuffer_->invalidate(agents_.size() - 1);
+
+			return agents_.size() - 1;
+		}
+
+		const std::size_t agentNo = freeAgentNos_.back();
+		freeAgentNos_.pop_back();
+
+		agent->generation_ = agents_[agentNo]->generation_;
+		releaseParameters(agents_[agentNo]->parametersNo_);
+		delete agents_[agentNo];
+		agents_[agentNo] = agent;
+
+		kdTree_->agentsChanged_ = true;
+		kinematicsChanged_ = true;
+		stateBuffer_->invalidate(agentNo);
+
+		return agentNo;
+	}
+
+	void Simulator::integrate(float timeStep)
+	{
+		if (threadPool_->isTaskPending()) {
+			throw std::runtime_error("Asynchronous step in progress when attempting to integrate.");
+		}
+
+		if (kinematicsChanged_) {
+			groupAgentsByKinematics();
+		}
+
+		// The progress of an agent towards its goal depends only on its own state, so it is updated in the same pass as its motion.
+		threadPool_->parallelFor(holonomicAgents_.size(), [this, timeStep](std::size_t i) {
+			Agent *const agent = agents_[holonomicAgents_[i]];
+			agent->updateHolonomic(timeStep);
+			agent->updateGoal();
+		});
+
+		threadPool_->parallelFor(differentialDriveAgents_.size(), [this, timeStep](std::size_t i) {
+			Agent *const agent = agents_[differentialDriveAgents_[i]];
+			agent->updateDifferentialDrive(timeStep);
+			agent->updateGoal();
+		});
+
+		threadPool_->parallelFor(omnidirectionalAgents_.size(), [this, timeStep](std::size_t i) {
+			Agent *const agent = agents_[omnidirectionalAgents_[i]];
+			agent->updateOmnidirectional(timeStep);
+			agent->updateGoal();
+		});
+
+		finishStep(timeStep);
+	}
+
+	void Simulator::releaseParameters(std::size_t parametersNo)
+	{
+		if (--numParametersUsers_[parametersNo] == 0) {
+			freeParametersNos_.push_back(parametersNo);
+		}
+	}
+
+	void Simulator::removeAgent(const AgentHandle &handle)
+	{
+		if (!hasAgent(handle)) {
+			throw std::runtime_error("Agent not found when removing agent.");
+		}
+
+		Agent *const agent = agents_[handle.agentNo_];
+
+		// Advancing the generation invalidates every handle to the agent.
+		++agent->generation_;
+		agent->removed_ = true;
+		agent->reachedGoal_ = true;
+		agent->newVelocity_ = Vector2(0.0f, 0.0f);
+		agent->prefVelocity_ = Vector2(0.0f, 0.0f);
+		agent->velocity_ = Vector2(0.0f, 0.0f);
+		agent->neighbors_.clear();
+
+		freeAgentNos_.push_back(handle.agentNo_);
+		kdTree_->agentsChanged_ = true;
+		kinematicsChanged_ = true;
+
+		stateBuffer_->invalidate(handle.agentNo_);
+		stateBuffer_->publish();
+	}
+
+	void Simulator::restoreSnapshot(const Snapshot &snapshot)
+	{
+		const auto restoreAgent = [](const Snapshot::AgentState &state, Agent *agent) {
+			agent->newVelocity_ = state.newVelocity_;
+			agent->position_ = state.position_;
+			agent->prefVelocity_ = state.prefVelocity_;
+			agent->velocity_ = state.velocity_;
+			agent->generation_ = state.generation_;
+			agent->goalNo_ = state.goalNo_;
+			agent->knot_ = state.knot_;
+			agent->waypoint_ = state.waypoint_;
+			agent->parametersNo_ = state.parametersNo_;
+			agent->profileNo_ = state.profileNo_;
+			agent->nextDecisionTime_ = state.nextDecisionTime_;
+			agent->orientation_ = state.orientation_;
+			agent->overrides_ = state.overrides_;
+			agent->leftWheelSpeed_ = state.leftWheelSpeed_;
+			agent->rightWheelSpeed_ = state.rightWheelSpeed_;
+			agent->reachedGoal_ = state.reachedGoal_;
+			agent->removed_ = state.removed_;
+			agent->neighbors_.clear();
+			agent->neighbors_.insert(state.neighbors_.begin(), state.neighbors_.end());
+		};
+
+		parameters_ = snapshot.parameters_;
+		numParametersUsers_ = snapshot.numParametersUsers_;
+		freeParametersNos_ = snapshot.freeParametersNos_;
+		defaultsNo_ = snapshot.defaultsNo_;
+		profiles_ = snapshot.profiles_;
+		profileNames_ = snapshot.profileNames_;
+
+		while (agents_.size() > snapshot.agents_.size()) {
+			delete agents_.back();
+			agents_.pop_back();
+		}
+
+		while (agents_.size() < snapshot.agents_.size()) {
+			agents_.push_back(new Agent(this));
+		}
+
+		for (std::size_t agentNo = 0; agentNo < agents_.size(); ++agentNo) {
+			restoreAgent(snapshot.agents_[agentNo], agents_[agentNo]);
+		}
+
+		freeAgentNos_ = snapshot.freeAgentNos_;
+		kdTree_->agentsChanged_ = true;
+		kinematicsChanged_ = true;
+
+		goals_.resize(snapshot.goals_.size(), Goal(0, 0));
+		positionGoalNos_ = snapshot.positionGoalNos_;
+
+		for (std::size_t goalNo = 0; goalNo < goals_.size(); ++goalNo) {
+			goals_[goalNo].trajectory_ = snapshot.goals_[goalNo].trajectory_;
+			goals_[goalNo].begin_ = snapshot.goals_[goalNo].begin_;
+			goals_[goalNo].end_ = snapshot.goals_[goalNo].end_;
+		}
+
+		// A shared waypoint pool is replaced outright rather than copied and then overwritten.
+		if (*waypoints_ != snapshot.waypoints_) {
+			if (waypoints_.use_count() > 1) {
+				waypoints_ = std::make_shared<std::vector<Vector2> >(snapshot.waypoints_);
+			}
+			else {
+				*waypoints_ = snapshot.waypoints_;
+			}
+		}
+
+		globalTime_ = snapshot.globalTime_;
+		maxDecisionInterval_ = snapshot.maxDecisionInterval_;
+		minDecisionInterval_ = snapshot.minDecisionInterval_;
+		minSubStep_ = snapshot.minSubStep_;
+		overlapTolerance_ = snapshot.overlapTolerance_;
+		timeStep_ = snapshot.timeStep_;
+		reachedGoals_ = snapshot.reachedGoals_;
+
+		stateBuffer_->invalidate();
+		stateBuffer_->publish();
+	}
+
+	void Simulator::runRollouts(std::vector<Rollout> &rollouts, float duration) const
+	{
+		if (threadPool_->isTaskPending()) {
+			throw std::runtime_error("Asynchronous step in progress when attempting to run rollouts.");
+		}
+
+		if (timeStep_ == 0.0f) {
+			throw std::runtime_error("Time step not set when running rollouts.");
+		}
+
+		const std::size_t numSteps = static_cast<std::size_t>(std::ceil(duration / timeStep_ - HRVO_EPSILON));
+
+		// Each rollout runs serially on its own clone, so rollouts are claimed one at a time.
+		threadPool_->parallelFor(rollouts.size(), [this, &rollouts, numSteps](std::size_t rolloutNo) {
+			Rollout &rollout = rollouts[rolloutNo];
+			Simulator *const simulator = clone();
+
+			for (std::vector<std::pair<std::size_t, std::size_t> >::const_iterator iter = rollout.agentGoals_.begin(); iter != rollout.agentGoals_.end(); ++iter) {
+				simulator->setAgentGoal(iter->first, iter->second);
+			}
+
+			rollout.minClearance_ = std::numeric_limits<float>::infinity();
+
+			for (std::size_t step = 0; step < numSteps; ++step) {
+				simulator->doStep();
+
+				for (std::vector<Agent *>::const_iterator iter = simulator->agents_.begin(); iter != simulator->agents_.end(); ++iter) {
+					for (std::set<std::pair<float, std::size_t> >::const_iterator neighbor = (*iter)->neighbors_.begin(); neighbor != (*iter)->neighbors_.end(); ++neighbor) {
+						const Agent *const other = simulator->agents_[neighbor->second];
+
+						rollout.minClearance_ = std::min(rollout.minClearance_, abs(other->position_ - (*iter)->position_) - (*iter)->getParameters().radius_ - other->getParameters().radius_);
+					}
+				}
+
+				if (simulator->reachedGoals_) {
+					break;
+				}
+			}
+
+			rollout.numReachedGoals_ = 0;
+			rollout.totalDistToGoals_ = 0.0f;
+
+			for (std::vector<Agent *>::const_iterator iter = simulator->agents_.begin(); iter != simulator->agents_.end(); ++iter) {
+				if ((*iter)->removed_) {
+					continue;
+				}
+
+				if ((*iter)->reachedGoal_) {
+					++rollout.numReachedGoals_;
+				}
+
+				rollout.totalDistToGoals_ += abs((*simulator->waypoints_)[(*iter)->waypoint_] - (*iter)->position_);
+			}
+
+			rollout.globalTime_ = simulator->globalTime_;
+			rollout.reachedGoals_ = simulator->reachedGoals_;
+
+			delete simulator;
+		}, 1);
+	}
+
+	void Simulator::saveSnapshot(Snapshot &snapshot) const
+	{
+		const auto saveAgent = [this](const Agent *agent, Snapshot::AgentState &state) {
+			state.newVelocity_ = agent->newVelocity_;
+			state.position_ = agent->position_;
+			state.prefVelocity_ = agent->prefVelocity_;
+			state.velocity_ = agent->velocity_;
+			state.generation_ = agent->generation_;
+			state.goalNo_ = agent->goalNo_;
+			state.knot_ = agent->knot_;
+			state.waypoint_ = agent->waypoint_;
+			state.parametersNo_ = agent->parametersNo_;
+			state.profileNo_ = agent->profileNo_;
+			state.nextDecisionTime_ = agent->nextDecisionTime_;
+			state.orientation_ = agent->orientation_;
+			state.overrides_ = agent->overrides_;
+			state.leftWheelSpeed_ = agent->leftWheelSpeed_;
+			state.rightWheelSpeed_ = agent->rightWheelSpeed_;
+			state.reachedGoal_ = agent->reachedGoal_;
+			state.removed_ = agent->removed_;
+			state.neighbors_.clear();
+
+			// Without decision intervals every agent finds its neighbors again before it uses them.
+			if (maxDecisionInterval_ > 0.0f) {
+				state.neighbors_.assign(agent->neighbors_.begin(), agent->neighbors_.end());
+			}
+		};
+
+		// The parameter table is shared with the snapshot until either changes it.
+		snapshot.parameters_ = parameters_;
+		snapshot.numParametersUsers_ = numParametersUsers_;
+		snapshot.freeParametersNos_ = freeParametersNos_;
+		snapshot.defaultsNo_ = defaultsNo_;
+		snapshot.profiles_ = profiles_;
+		snapshot.profileNames_ = profileNames_;
+		snapshot.agents_.resize(agents_.size());
+
+		for (std::size_t agentNo = 0; agentNo < agents_.size(); ++agentNo) {
+			saveAgent(agents_[agentNo], snapshot.agents_[agentNo]);
+		}
+
+		snapshot.freeAgentNos_ = freeAgentNos_;
+		snapshot.positionGoalNos_ = positionGoalNos_;
+		snapshot.goals_.resize(goals_.size());
+
+		for (std::size_t goalNo = 0; goalNo < goals_.size(); ++goalNo) {
+			snapshot.goals_[goalNo].trajectory_ = goals_[goalNo].trajectory_;
+			snapshot.goals_[goalNo].begin_ = goals_[goalNo].begin_;
+			snapshot.goals_[goalNo].end_ = goals_[goalNo].end_;
+		}
+
+		snapshot.waypoints_ = *waypoints_;
+
+		snapshot.globalTime_ = globalTime_;
+		snapshot.maxDecisionInterval_ = maxDecisionInterval_;
+		snapshot.minDecisionInterval_ = minDecisionInterval_;
+		snapshot.minSubStep_ = minSubStep_;
+		snapshot.overlapTolerance_ = overlapTolerance_;
+		snapshot.timeStep_ = timeStep_;
+		snapshot.reachedGoals_ = reachedGoals_;
+	}
+
+	void Simulator::separateOverlaps(float timeStep)
+	{
+		threadPool_->parallelFor(kdTree_->agents_.size(), [this, timeStep](std::size_t i) {
+			if (separating_[i] != 0) {
+				Agent *const agent = agents_[kdTree_->agents_[i]];
+				agent->computeNewVelocity(timeStep);
+
+				if (agent->getParameters().kinematics_ == KINEMATICS_DIFFERENTIAL_DRIVE) {
+					agent->computeWheelSpeeds();
+				}
+			}
+		});
+	}
+
+	void Simulator::setAdaptiveTimeStep(float overlapTolerance, float minSubStep)
+	{
+		overlapTolerance_ = overlapTolerance;
+		minSubStep_ = minSubStep;
+	}
+
+	void Simulator::setAgentDefaults(float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset, float maxAccel, const Vector2 &velocity, float orientation, float timeHorizon, float clusterDist)
+	{
+		// Agents already added keep the defaults with which they were added.
+		const std::size_t defaultsNo = addParameters(AgentParameters(neighborDist, maxNeighbors, radius, goalRadius, prefSpeed, maxSpeed, uncertaintyOffset, maxAccel, velocity, orientation, timeHorizon, clusterDist));
+		++numParametersUsers_[defaultsNo];
+
+		if (defaultsNo_ != HRVO_NO_PARAMETERS) {
+			releaseParameters(defaultsNo_);
+		}
+
+		defaultsNo_ = defaultsNo;
+	}
+
+	void Simulator::setAgentDefaultKinematics(KinematicModel kinematics)
+	{
+		if (defaultsNo_ == HRVO_NO_PARAMETERS) {
+			throw std::runtime_error("Agent defaults not set when setting agent default kinematics.");
+		}
+
+		setAgentDefaultKinematics(kinematics, (*parameters_)[defaultsNo_].timeToOrientation_, (*parameters_)[defaultsNo_].wheelTrack_);
 	}
 
-	void Simulator::setAgentDefaults(float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed,
-#if HRVO_DIFFERENTIAL_DRIVE
-		float timeToOrientation, float wheelTrack,
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-		float uncertaintyOffset, float maxAccel, const Vector2 &velocity, float orientation)
+	void Simulator::setAgentDefaultKinematics(KinematicModel kinematics, float timeToOrientation, float wheelTrack)
 	{
-		if (defaults_ == NULL) {
-			defaults_ = new Agent(this);
+		if (defaultsNo_ == HRVO_NO_PARAMETERS) {
+			throw std::runtime_error("Agent defaults not set when setting agent default kinematics.");
 		}
 
-		defaults_->goalRadius_ = goalRadius;
-		defaults_->maxAccel_ = maxAccel;
-		defaults_->maxNeighbors_ = maxNeighbors;
-		defaults_->maxSpeed_ = maxSpeed;
-		defaults_->neighborDist_ = neighborDist;
-		defaults_->newVelocity_ = velocity;
-		defaults_->uncertaintyOffset_ = uncertaintyOffset;
-		defaults_->orientation_ = orientation;
-		defaults_->prefSpeed_ = prefSpeed;
-		defaults_->radius_ = radius;
-		defaults_->velocity_ = velocity;
+		AgentParameters defaults = (*parameters_)[defaultsNo_];
+		defaults.kinematics_ = kinematics;
+		defaults.timeToOrientation_ = timeToOrientation;
+		defaults.wheelTrack_ = wheelTrack;
+		checkDifferentialDrive(defaults, "setting agent default kinematics");
 
-#if HRVO_DIFFERENTIAL_DRIVE
-		defaults_->timeToOrientation_ = timeToOrientation;
-		defaults_->wheelTrack_ = wheelTrack;
+		unshareParameters(defaultsNo_) = defaults;
+	}
 
-		defaults_->computeWheelSpeeds();
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
+	void Simulator::setAgentClusterDist(std::size_t agentNo, float clusterDist)
+	{
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.clusterDist_ = clusterDist;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_CLUSTER_DIST;
 	}
 
 	void Simulator::setAgentGoal(std::size_t agentNo, std::size_t goalNo)
 	{
+		if (goalNo >= goals_.size()) {
+			throw std::runtime_error("Goal not found when setting agent goal.");
+		}
+
 		agents_[agentNo]->goalNo_ = goalNo;
+		agents_[agentNo]->knot_ = 0;
+		agents_[agentNo]->nextDecisionTime_ = globalTime_;
+		agents_[agentNo]->waypoint_ = goals_[goalNo].begin_;
 	}
 
-	void Simulator::setAgentGoalPosition(std::size_t agentNo, Vector2 position)
+	void Simulator::setAgentGoalPosition(std::size_t agentNo, const Vector2 &position)
 	{
-        goals_[agentNo]->position_ = position;
+		if (positionGoalNos_.size() < agents_.size()) {
+			positionGoalNos_.resize(agents_.size(), HRVO_NO_GOAL);
+		}
+
+		// Each agent number owns a single-waypoint goal, which is moved rather than added again.
+		if (positionGoalNos_[agentNo] == HRVO_NO_GOAL) {
+			positionGoalNos_[agentNo] = addGoal(position);
+		}
+		else {
+			writeWaypoints()[goals_[positionGoalNos_[agentNo]].begin_] = position;
+		}
+
+		setAgentGoal(agentNo, positionGoalNos_[agentNo]);
 	}
 
 	void Simulator::setAgentGoalRadius(std::size_t agentNo, float goalRadius)
 	{
-		agents_[agentNo]->goalRadius_ = goalRadius;
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.goalRadius_ = goalRadius;
+		parameters.computeSquares();
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_GOAL_RADIUS;
+	}
+
+	void Simulator::setAgentKinematics(std::size_t agentNo, KinematicModel kinematics)
+	{
+		AgentParameters candidate = agents_[agentNo]->getParameters();
+		candidate.kinematics_ = kinematics;
+		checkDifferentialDrive(candidate, "setting agent kinematics");
+
+		unshareParameters(agents_[agentNo]->parametersNo_).kinematics_ = kinematics;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_KINEMATICS;
+
+		if (kinematics == KINEMATICS_DIFFERENTIAL_DRIVE) {
+			agents_[agentNo]->computeWheelSpeeds();
+		}
+
+		kinematicsChanged_ = true;
 	}
 
 	void Simulator::setAgentMaxAccel(std::size_t agentNo, float maxAccel)
 	{
-		agents_[agentNo]->maxAccel_ = maxAccel;
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.maxAccel_ = maxAccel;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_MAX_ACCEL;
 	}
 
 	void Simulator::setAgentMaxNeighbors(std::size_t agentNo, std::size_t maxNeighbors)
 	{
-		agents_[agentNo]->maxNeighbors_ = maxNeighbors;
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.maxNeighbors_ = maxNeighbors;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_MAX_NEIGHBORS;
 	}
 
 	void Simulator::setAgentMaxSpeed(std::size_t agentNo, float maxSpeed)
 	{
-		agents_[agentNo]->maxSpeed_ = maxSpeed;
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.maxSpeed_ = maxSpeed;
+		parameters.computeSquares();
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_MAX_SPEED;
 	}
 
 	void Simulator::setAgentNeighborDist(std::size_t agentNo, float neighborDist)
 	{
-		agents_[agentNo]->neighborDist_ = neighborDist;
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.neighborDist_ = neighborDist;
+		parameters.computeSquares();
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_NEIGHBOR_DIST;
 	}
 
 	void Simulator::setAgentOrientation(std::size_t agentNo, float orientation)
 	{
 		agents_[agentNo]->orientation_ = orientation;
+		stateBuffer_->invalidate(agentNo);
+		stateBuffer_->publish();
 	}
 
 	void Simulator::setAgentPosition(std::size_t agentNo, const Vector2 &position)
 	{
+		agents_[agentNo]->nextDecisionTime_ = globalTime_;
 		agents_[agentNo]->position_ = position;
+		stateBuffer_->invalidate(agentNo);
+		stateBuffer_->publish();
 	}
 
 	void Simulator::setAgentPrefSpeed(std::size_t agentNo, float prefSpeed)
 	{
-		agents_[agentNo]->prefSpeed_ = prefSpeed;
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.prefSpeed_ = prefSpeed;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_PREF_SPEED;
+	}
+
+	void Simulator::setAgentProfile(std::size_t agentNo, std::size_t profileNo)
+	{
+		if (profileNo >= profiles_.size()) {
+			throw std::runtime_error("Agent profile not found when setting agent profile.");
+		}
+
+		releaseParameters(agents_[agentNo]->parametersNo_);
+		++numParametersUsers_[profiles_[profileNo]];
+
+		agents_[agentNo]->parametersNo_ = profiles_[profileNo];
+		agents_[agentNo]->profileNo_ = profileNo;
+		agents_[agentNo]->overrides_ = 0;
+		kinematicsChanged_ = true;
+	}
+
+	void Simulator::setAgentProfileKinematics(std::size_t profileNo, KinematicModel kinematics)
+	{
+		if (profileNo >= profiles_.size()) {
+			throw std::runtime_error("Agent profile not found when setting agent profile kinematics.");
+		}
+
+		setAgentProfileKinematics(profileNo, kinematics, (*parameters_)[profiles_[profileNo]].timeToOrientation_, (*parameters_)[profiles_[profileNo]].wheelTrack_);
+	}
+
+	void Simulator::setAgentProfileKinematics(std::size_t profileNo, KinematicModel kinematics, float timeToOrientation, float wheelTrack)
+	{
+		if (profileNo >= profiles_.size()) {
+			throw std::runtime_error("Agent profile not found when setting agent profile kinematics.");
+		}
+
+		AgentParameters profile = (*parameters_)[profiles_[profileNo]];
+		profile.kinematics_ = kinematics;
+		profile.timeToOrientation_ = timeToOrientation;
+		profile.wheelTrack_ = wheelTrack;
+		checkDifferentialDrive(profile, "setting agent profile kinematics");
+
+		// Agents with the profile that set a time to orientation or wheel track on themselves keep it.
+		for (std::vector<Agent *>::const_iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
+			if ((*iter)->profileNo_ == profileNo && (*iter)->parametersNo_ != profiles_[profileNo]) {
+				AgentParameters parameters = (*iter)->getParameters();
+				parameters.applyProfile(profile, (*iter)->overrides_);
+				checkDifferentialDrive(parameters, "setting agent profile kinematics");
+			}
+		}
+
+		writeParameters(profiles_[profileNo]) = profile;
+		applyProfile(profileNo);
+
+		kinematicsChanged_ = true;
+	}
+
+	void Simulator::setAgentProfileProperties(std::size_t profileNo, float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset, float maxAccel, const Vector2 &velocity, float orientation, float timeHorizon, float clusterDist)
+	{
+		if (profileNo >= profiles_.size()) {
+			throw std::runtime_error("Agent profile not found when setting agent profile properties.");
+		}
+
+		AgentParameters &profile = writeParameters(profiles_[profileNo]);
+		AgentParameters parameters(neighborDist, maxNeighbors, radius, goalRadius, prefSpeed, maxSpeed, uncertaintyOffset, maxAccel, velocity, orientation, timeHorizon, clusterDist);
+
+		// The kinematic model of the profile is set separately, so it is kept.
+		parameters.kinematics_ = profile.kinematics_;
+		parameters.timeToOrientation_ = profile.timeToOrientation_;
+		parameters.wheelTrack_ = profile.wheelTrack_;
+		profile = parameters;
+
+		applyProfile(profileNo);
 	}
 
 	void Simulator::setAgentRadius(std::size_t agentNo, float radius)
 	{
-		agents_[agentNo]->radius_ = radius;
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.radius_ = radius;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_RADIUS;
+	}
+
+	void Simulator::setAgentTimeHorizon(std::size_t agentNo, float timeHorizon)
+	{
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.timeHorizon_ = timeHorizon;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_TIME_HORIZON;
 	}
 
-#if HRVO_DIFFERENTIAL_DRIVE
 	void Simulator::setAgentTimeToOrientation(std::size_t agentNo, float timeToOrientation)
 	{
-		agents_[agentNo]->timeToOrientation_ = timeToOrientation;
+		AgentParameters candidate = agents_[agentNo]->getParameters();
+		candidate.timeToOrientation_ = timeToOrientation;
+		checkDifferentialDrive(candidate, "setting agent time to orientation");
+
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.timeToOrientation_ = timeToOrientation;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_TIME_TO_ORIENTATION;
 	}
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
 
 	void Simulator::setAgentUncertaintyOffset(std::size_t agentNo, float uncertaintyOffset)
 	{
-		agents_[agentNo]->uncertaintyOffset_ = uncertaintyOffset;
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.uncertaintyOffset_ = uncertaintyOffset;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_UNCERTAINTY_OFFSET;
 	}
 
 	void Simulator::setAgentVelocity(std::size_t agentNo, const Vector2 &velocity)
 	{
+		agents_[agentNo]->nextDecisionTime_ = globalTime_;
 		agents_[agentNo]->velocity_ = velocity;
+		stateBuffer_->invalidate(agentNo);
+		stateBuffer_->publish();
+	}
+
+	void Simulator::setAgentVelocities(std::size_t agentNo, std::size_t numAgents, const Vector2 *velocities)
+	{
+		if (agentNo > agents_.size() || numAgents > agents_.size() - agentNo) {
+			throw std::runtime_error("Agent not found when setting agent velocities.");
+		}
+
+		for (std::size_t i = 0; i < numAgents; ++i) {
+			agents_[agentNo + i]->nextDecisionTime_ = globalTime_;
+			agents_[agentNo + i]->velocity_ = velocities[i];
+			stateBuffer_->invalidate(agentNo + i);
+		}
+
+		stateBuffer_->publish();
+	}
+
+	void Simulator::setDecisionIntervals(float minInterval, float maxInterval)
+	{
+		minDecisionInterval_ = minInterval;
+		maxDecisionInterval_ = maxInterval;
+
+		// Decisions scheduled under the previous bounds would otherwise be kept, even with a maximum of zero.
+		for (std::vector<Agent *>::const_iterator iter = agents_.begin(); iter != agents_.end(); ++iter) {
+			(*iter)->nextDecisionTime_ = globalTime_;
+		}
+	}
+
+	void Simulator::setNavigationGrid(const Vector2 &origin, std::size_t numColumns, std::size_t numRows, float cellSize)
+	{
+		delete navigationGrid_;
+		navigationGrid_ = NULL;
+
+		if (numColumns > 0 && numRows > 0) {
+			if (cellSize <= 0.0f) {
+				throw std::runtime_error("Cell size not positive when setting navigation grid.");
+			}
+
+			navigationGrid_ = new NavigationGrid(origin, numColumns, numRows, cellSize);
+		}
+	}
+
+	void Simulator::setNavigationGridCellBlocked(const Vector2 &position, bool blocked)
+	{
+		if (navigationGrid_ == NULL) {
+			throw std::runtime_error("Navigation grid not set when blocking cell.");
+		}
+
+		navigationGrid_->setCellBlocked(position, blocked);
+	}
+
+	void Simulator::setNeighborAutoTuning(bool autoTuning)
+	{
+		if (autoTuning && neighborTuner_ == NULL) {
+			neighborTuner_ = new NeighborTuner(this);
+		}
+		else if (!autoTuning && neighborTuner_ != NULL) {
+			neighborTuner_->restore();
+			delete neighborTuner_;
+			neighborTuner_ = NULL;
+		}
+	}
+
+	void Simulator::setNeighborBruteForceThreshold(std::size_t numAgents)
+	{
+		// While the neighbor index is tuned, the threshold takes effect once tuning is disabled.
+		if (neighborTuner_ != NULL) {
+			neighborTuner_->bruteForceThreshold_ = numAgents;
+		}
+		else {
+			kdTree_->bruteForceThreshold_ = numAgents;
+		}
+	}
+
+	void Simulator::setNeighborSurfaceDistance(bool surfaceDistance)
+	{
+		kdTree_->surfaceDistance_ = surfaceDistance;
+	}
+
+	void Simulator::setNumThreads(std::size_t numThreads)
+	{
+		if (threadPool_->isTaskPending()) {
+			throw std::runtime_error("Asynchronous step in progress when attempting to set number of threads.");
+		}
+
+		if (numThreads == 0) {
+			numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		if (numThreads != threadPool_->getNumThreads()) {
+			delete threadPool_;
+			threadPool_ = new ThreadPool(numThreads);
+		}
+	}
+
+	AgentParameters &Simulator::unshareParameters(std::size_t &parametersNo)
+	{
+		if (numParametersUsers_[parametersNo] > 1) {
+			const AgentParameters parameters = (*parameters_)[parametersNo];
+			const std::size_t copyNo = addParameters(parameters);
+			++numParametersUsers_[copyNo];
+			releaseParameters(parametersNo);
+			parametersNo = copyNo;
+		}
+
+		return writeParameters(parametersNo);
+	}
+
+	std::vector<AgentParameters> &Simulator::writeParameterTable()
+	{
+		// The parameter table may be shared with clones and snapshots, which must not see it change.
+		if (parameters_.use_count() > 1) {
+			parameters_ = std::make_shared<std::vector<AgentParameters> >(*parameters_);
+		}
+
+		return *parameters_;
+	}
+
+	AgentParameters &Simulator::writeParameters(std::size_t parametersNo)
+	{
+		return writeParameterTable()[parametersNo];
+	}
+
+	std::vector<Vector2> &Simulator::writeWaypoints()
+	{
+		// The waypoint pool may be shared with clones, which must not see it change.
+		if (waypoints_.use_count() > 1) {
+			waypoints_ = std::make_shared<std::vector<Vector2> >(*waypoints_);
+		}
+
+		return *waypoints_;
 	}
 
     Vector2 Simulator::getAgentPrefVelocity(std::size_t agentNo) const {
-        return agents_[agentNo]->prefVelocity_;
+        const StateBuffer::Reader state(*stateBuffer_);
+
+        return state->agents_[agentNo].prefVelocity_;
     }
 
-#if HRVO_DIFFERENTIAL_DRIVE
 	void Simulator::setAgentWheelTrack(std::size_t agentNo, float wheelTrack)
 	{
-		agents_[agentNo]->wheelTrack_ = wheelTrack;
+		AgentParameters candidate = agents_[agentNo]->getParameters();
+		candidate.wheelTrack_ = wheelTrack;
+		checkDifferentialDrive(candidate, "setting agent wheel track");
+
+		AgentParameters &parameters = unshareParameters(agents_[agentNo]->parametersNo_);
+		parameters.wheelTrack_ = wheelTrack;
+		agents_[agentNo]->overrides_ |= AgentParameters::PROFILE_WHEEL_TRACK;
 	}
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
 }
@@ -38,30 +38,69 @@
 #ifndef HRVO_SIMULATOR_H_
 #define HRVO_SIMULATOR_H_
 
+#include <future>
 #include <limits>
+#include <memory>
+#include <string>
 #include <vector>
 #include <Goal.h>
 
 
+#include "AgentHandle.h"
 #include "Export.h"
 #include "Vector2.h"
 
-/**
- * \brief  Set to 0 for a holonomic agent; set to 1 for a differential-drive agent.
- */
-#define HRVO_DIFFERENTIAL_DRIVE 0
-
 namespace hrvo {
 	class Agent;
+	class AgentParameters;
 	class Goal;
 	class KdTree;
+	class NavigationGrid;
+	class NeighborTuner;
+	class Rollout;
+	class Snapshot;
+	class StateBuffer;
+	class ThreadPool;
+	class Trajectory;
 
 	/**
-	 * \class  Simulator
-	 * \brief  The simulation.
+	 * \class    Simulator
+	 * \brief    The simulation.
+	 *
+	 * \details  The global time, the counts of agents, the progress towards
+	 *           their goals, and the orientation, position, preferred
+	 *           velocity, and velocity of each agent may be read from other
+	 *           threads while doStep() runs. They return the state of the last
+	 *           completed step or change without locking. All other methods
+	 *           must be called from the thread that calls doStep().
 	 */
 	class HRVO_EXPORT Simulator {
 	public:
+		/**
+		 * \brief  The kinematic models by which agents move towards their new velocities.
+		 */
+		enum KinematicModel {
+			/**
+			 * \brief  Moves in any direction, with the change in velocity limited in magnitude by the maximum acceleration.
+			 */
+			KINEMATICS_HOLONOMIC,
+
+			/**
+			 * \brief  Moves along its orientation, turning with the difference between the speeds of its left and right wheels.
+			 */
+			KINEMATICS_DIFFERENTIAL_DRIVE,
+
+			/**
+			 * \brief  Moves in any direction, with the change in velocity limited along each axis by the maximum acceleration.
+			 */
+			KINEMATICS_OMNIDIRECTIONAL
+		};
+
+		/**
+		 * \brief  The agent profile of an agent added with the agent defaults or individual properties.
+		 */
+		static const std::size_t HRVO_NO_AGENT_PROFILE = static_cast<std::size_t>(-1);
+
 		/**
 		 * \brief  Constructor.
 		 */
@@ -74,12 +113,26 @@ namespace hrvo {
 
 		/**
 		 * \brief      Adds a new agent with default properties to the simulation.
+		 *
+		 * \details    The number of the agent is that of the last agent
+		 *             removed, if its number has not been reused, or else one
+		 *             past the last number in use.
+		 *
 		 * \param[in]  position  The starting position of this agent.
 		 * \param[in]  goalNo    The goal number of this agent.
 		 * \return     The number of the agent.
 		 */
 		std::size_t addAgent(const Vector2 &position, std::size_t goalNo);
 
+		/**
+		 * \brief      Adds a new agent with the properties of an agent profile to the simulation.
+		 * \param[in]  position   The starting position of this agent.
+		 * \param[in]  goalNo     The goal number of this agent.
+		 * \param[in]  profileNo  The number of the agent profile of this agent.
+		 * \return     The number of the agent.
+		 */
+		std::size_t addAgent(const Vector2 &position, std::size_t goalNo, std::size_t profileNo);
+
 		/**
 		 * \brief      Adds a new agent to the simulation.
 		 * \param[in]  position           The starting position of this agent.
@@ -94,13 +147,67 @@ namespace hrvo {
 		 * \param[in]  maxAccel           The maximum acceleration of this agent.
 		 * \param[in]  velocity           The initial velocity of this agent.
 		 * \param[in]  orientation        The initial orientation (in radians) of this agent.
+		 * \param[in]  timeHorizon        The time horizon of this agent.
 		 * \return     The number of the agent.
 		 */
-		std::size_t addAgent(const Vector2 &position, std::size_t goalNo, float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed,
-#if HRVO_DIFFERENTIAL_DRIVE
-			float timeToOrientation, float wheelTrack,
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-			float uncertaintyOffset = 0.0f, float maxAccel = std::numeric_limits<float>::infinity(), const Vector2 &velocity = Vector2(0.0f, 0.0f), float orientation = 0.0f);
+		std::size_t addAgent(const Vector2 &position, std::size_t goalNo, float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset = 0.0f, float maxAccel = std::numeric_limits<float>::infinity(), const Vector2 &velocity = Vector2(0.0f, 0.0f), float orientation = 0.0f, float timeHorizon = std::numeric_limits<float>::infinity());
+
+		/**
+		 * \brief      Adds new agents with default properties to the simulation.
+		 *
+		 * \details    Equivalent to adding each agent in turn, but the agent
+		 *             list is grown and the agent states are published once.
+		 *
+		 * \param[in]  positions  The starting positions of these agents.
+		 * \param[in]  goalNos    The goal numbers of these agents.
+		 * \param[in]  numAgents  The count of these agents.
+		 * \param[out] agentNos   The array of at least numAgents numbers assigned to these agents, which reuse the numbers of removed agents first and so need be neither consecutive nor ordered; may be NULL.
+		 */
+		void addAgents(const Vector2 *positions, const std::size_t *goalNos, std::size_t numAgents, std::size_t *agentNos = NULL);
+
+		/**
+		 * \brief      Adds new agents, each with the properties of an agent profile or the default properties, to the simulation.
+		 *
+		 * \details    Equivalent to adding each agent in turn, but the agent
+		 *             list is grown and the agent states are published once,
+		 *             so that a scene of several types of agent is populated
+		 *             with a single call. Every goal and profile is checked
+		 *             before any agent is added.
+		 *
+		 * \param[in]  positions   The starting positions of these agents.
+		 * \param[in]  goalNos     The goal numbers of these agents.
+		 * \param[in]  profileNos  The agent profile numbers of these agents, in which HRVO_NO_AGENT_PROFILE selects the default properties; may be NULL for the default properties throughout.
+		 * \param[in]  numAgents   The count of these agents.
+		 * \param[out] agentNos    The array of at least numAgents numbers assigned to these agents, which reuse the numbers of removed agents first and so need be neither consecutive nor ordered; may be NULL.
+		 */
+		void addAgents(const Vector2 *positions, const std::size_t *goalNos, const std::size_t *profileNos, std::size_t numAgents, std::size_t *agentNos = NULL);
+
+		/**
+		 * \brief      Adds a named agent profile, a set of properties shared by a type of agent, to the simulation.
+		 *
+		 * \details    Each agent added with the profile shares its properties,
+		 *             which are held once for all such agents, and so takes
+		 *             any change to them made later with
+		 *             setAgentProfileProperties(). Setting a property on the
+		 *             agent itself gives the agent a copy of the properties
+		 *             of its own, in which it keeps that property.
+		 *
+		 * \param[in]  name               The name of the profile, which is unique.
+		 * \param[in]  neighborDist       The maximum neighbor distance of an agent with the profile.
+		 * \param[in]  maxNeighbors       The maximum neighbor count of an agent with the profile.
+		 * \param[in]  radius             The radius of an agent with the profile.
+		 * \param[in]  goalRadius         The goal radius of an agent with the profile.
+		 * \param[in]  prefSpeed          The preferred speed of an agent with the profile.
+		 * \param[in]  maxSpeed           The maximum speed of an agent with the profile.
+		 * \param[in]  uncertaintyOffset  The uncertainty offset of an agent with the profile.
+		 * \param[in]  maxAccel           The maximum acceleration of an agent with the profile.
+		 * \param[in]  velocity           The initial velocity of a new agent with the profile.
+		 * \param[in]  orientation        The initial orientation (in radians) of a new agent with the profile.
+		 * \param[in]  timeHorizon        The time horizon of an agent with the profile.
+		 * \param[in]  clusterDist        The cluster distance of an agent with the profile.
+		 * \return     The number of the profile.
+		 */
+		std::size_t addAgentProfile(const std::string &name, float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset = 0.0f, float maxAccel = std::numeric_limits<float>::infinity(), const Vector2 &velocity = Vector2(), float orientation = 0.0f, float timeHorizon = std::numeric_limits<float>::infinity(), float clusterDist = std::numeric_limits<float>::infinity());
 
 		/**
 		 * \brief      Adds a new goal to the simulation.
@@ -109,13 +216,114 @@ namespace hrvo {
 		 */
 		std::size_t addGoal(const Vector2 &position);
 
-        std::size_t addGoalPositions(const std::vector<Vector2> &positions);
+		/**
+		 * \brief      Adds a new goal to the simulation that is a route through waypoints visited in order.
+		 *
+		 * \details    Each agent with the goal keeps its own progress along the
+		 *             route, so a route may be shared by any number of agents.
+		 *
+		 * \param[in]  positions  The positions of the waypoints of this goal, of which there is at least one.
+		 * \return     The number of the goal.
+		 */
+		std::size_t addGoalPositions(const std::vector<Vector2> &positions);
 
 		/**
-		 * \brief  Performs a simulation step; updates the orientation, position, and velocity of each agent, and the progress of each towards its goal.
+		 * \brief      Adds a new goal to the simulation that is a trajectory to be tracked.
+		 *
+		 * \details    At each step, each agent with the goal evaluates the
+		 *             trajectory at the end of the step and prefers its
+		 *             velocity, corrected towards its position over the
+		 *             tracking time of the trajectory, so that the trajectory
+		 *             is tracked without setting goals at every step. The goal
+		 *             is reached at the final position of the trajectory once
+		 *             it has ended.
+		 *
+		 * \param[in]  trajectory  The trajectory of this goal, of which there is at least one knot.
+		 * \return     The number of the goal.
+		 */
+		std::size_t addGoalTrajectory(const Trajectory &trajectory);
+
+		/**
+		 * \brief      Updates the progress of each agent towards its goal and advances the global time, without moving any agent; the final stage of a simulation step for callers that move agents with their own dynamics and set their positions and velocities.
+		 * \param[in]  timeStep  The time by which to advance the global time.
+		 */
+		void advanceTime(float timeStep);
+
+		/**
+		 * \brief  Builds the neighbor index and computes the neighbors of each agent; the first stage of a simulation step, which may be skipped if no agent has moved or been added and no neighbor parameter has changed since it last ran.
+		 */
+		void buildIndex();
+
+		/**
+		 * \brief    Creates a copy of the simulation that steps independently of it.
+		 *
+		 * \details  The waypoint pool of the goals and the parameter table of
+		 *           the agents, profiles, and agent defaults are shared with
+		 *           the copy until either changes them; the state of each
+		 *           agent and its progress along its goal, the goals, the
+		 *           global time, the time step and its settings, and the
+		 *           configuration of the k-D tree are copied. The copy runs
+		 *           each step on the calling thread only.
+		 *
+		 * \return   A pointer to the copy, which the caller deletes.
+		 */
+		Simulator *clone() const;
+
+		/**
+		 * \brief  Computes the preferred velocity and the new velocity of each agent from the neighbors found by buildIndex(); the second stage of a simulation step. Throws if the time step is not set or if agents have been added or removed since buildIndex() last ran.
+		 */
+		void computeVelocities();
+
+		/**
+		 * \brief  Performs a simulation step; updates the orientation, position, and velocity of each agent, and the progress of each towards its goal. Equivalent to buildIndex(), computeVelocities(), and integrate() with the time step of the simulation, repeated for each sub-step if the time step is adaptive.
 		 */
 		void doStep();
 
+		/**
+		 * \brief   Starts a simulation step in the background and returns immediately.
+		 *
+		 * \details  Until the returned future is ready, the calling thread may
+		 *           only use the methods that may be called while doStep() runs,
+		 *           so that work for the next step is overlapped with this one
+		 *           and applied once the future is ready. Further calls to
+		 *           doStepAsync() queue steps behind this one, whereas calling
+		 *           doStep(), runRollouts(), or another method that advances
+		 *           the simulation or uses its threads throws until every
+		 *           queued step is complete.
+		 *
+		 * \return  A future that becomes ready, or holds the exception thrown by doStep(), once the step is complete.
+		 */
+		std::future<void> doStepAsync();
+
+		/**
+		 * \brief      Advances the simulation over as many whole steps as it remains quiescent, without computing them.
+		 *
+		 * \details    The simulation is quiescent while every agent is either
+		 *             parked, slowly at its final goal, or moving at its
+		 *             preferred velocity beyond the neighbor distance of every
+		 *             other agent and short of the deceleration distance and
+		 *             radius of its goal. Parked agents come to rest in place and
+		 *             other agents move in straight lines, so the state at the
+		 *             end of skipped step i of n is that of each agent at its
+		 *             position less (n - i) time steps at its velocity.
+		 *
+		 * \param[in]  maxSteps  The maximum number of steps to skip.
+		 * \return     The number of steps skipped, which is zero if the simulation is not quiescent.
+		 */
+		std::size_t fastForward(std::size_t maxSteps);
+
+		/**
+		 * \brief      Returns the cluster distance of a specified agent.
+		 *
+		 * \details    Neighbors beyond the cluster distance that lie in similar
+		 *             directions and move with similar velocities are merged
+		 *             into a single conservative velocity obstacle.
+		 *
+		 * \param[in]  agentNo  The number of the agent whose cluster distance is to be retrieved.
+		 * \return     The present cluster distance of the agent.
+		 */
+		float getAgentClusterDist(std::size_t agentNo) const;
+
 		/**
 		 * \brief      Returns the goal number of a specified agent.
 		 * \param[in]  agentNo  The number of the agent whose goal number is to be retrieved.
@@ -123,6 +331,13 @@ namespace hrvo {
 		 */
 		std::size_t getAgentGoal(std::size_t agentNo) const;
 
+		/**
+		 * \brief      Returns a handle that identifies a specified agent until it is removed.
+		 * \param[in]  agentNo  The number of the agent.
+		 * \return     The handle of the agent.
+		 */
+		AgentHandle getAgentHandle(std::size_t agentNo) const;
+
 		/**
 		 * \brief      Returns the goal radius of a specified agent.
 		 * \param[in]  agentNo  The number of the agent whose goal radius is to be retrieved.
@@ -130,14 +345,19 @@ namespace hrvo {
 		 */
 		float getAgentGoalRadius(std::size_t agentNo) const;
 
-#if HRVO_DIFFERENTIAL_DRIVE
 		/**
 		 * \brief      Returns the left wheel speed of a specified agent.
 		 * \param[in]  agentNo  The number of the agent whose left wheel speed is to be retrieved.
 		 * \return     The present signed left wheel speed of the agent.
 		 */
 		float getAgentLeftWheelSpeed(std::size_t agentNo) const;
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
+
+		/**
+		 * \brief      Returns the kinematic model of a specified agent.
+		 * \param[in]  agentNo  The number of the agent whose kinematic model is to be retrieved.
+		 * \return     The present kinematic model of the agent.
+		 */
+		KinematicModel getAgentKinematics(std::size_t agentNo) const;
 
 		/**
 		 * \brief      Returns the maximum acceleration of a specified agent.
@@ -160,6 +380,13 @@ namespace hrvo {
 		 */
 		float getAgentMaxSpeed(std::size_t agentNo) const;
 
+		/**
+		 * \brief      Returns the number of the agent identified by a handle.
+		 * \param[in]  handle  The handle of the agent.
+		 * \return     The number of the agent.
+		 */
+		std::size_t getAgentNo(const AgentHandle &handle) const;
+
 		/**
 		 * \brief      Returns the maximum neighbor distance of a specified agent.
 		 * \param[in]  agentNo  The number of the agent whose maximum neighbor distance is to be retrieved.
@@ -167,6 +394,13 @@ namespace hrvo {
 		 */
 		float getAgentNeighborDist(std::size_t agentNo) const;
 
+		/**
+		 * \brief      Returns the new velocity of a specified agent computed by the last call to computeVelocities().
+		 * \param[in]  agentNo  The number of the agent whose new velocity is to be retrieved.
+		 * \return     The new velocity of the agent.
+		 */
+		Vector2 getAgentNewVelocity(std::size_t agentNo) const;
+
 		/**
 		 * \brief      Returns the orientation of a specified agent.
 		 * \param[in]  agentNo  The number of the agent whose orientation is to be retrieved.
@@ -181,6 +415,14 @@ namespace hrvo {
 		 */
 		Vector2 getAgentPosition(std::size_t agentNo) const;
 
+		/**
+		 * \brief      Copies the positions of consecutive agents into an array, all from the same step.
+		 * \param[in]  agentNo    The number of the first agent.
+		 * \param[in]  numAgents  The count of agents.
+		 * \param[out] positions  The array of at least numAgents elements into which the present positions of the agents are copied.
+		 */
+		void getAgentPositions(std::size_t agentNo, std::size_t numAgents, Vector2 *positions) const;
+
 		/**
 		 * \brief      Returns the preferred speed of a specified agent.
      *
@@ -192,6 +434,20 @@ namespace hrvo {
 		 */
 		float getAgentPrefSpeed(std::size_t agentNo) const;
 
+		/**
+		 * \brief      Returns the agent profile of a specified agent.
+		 * \param[in]  agentNo  The number of the agent whose agent profile is to be retrieved.
+		 * \return     The number of the agent profile of the agent, or HRVO_NO_AGENT_PROFILE if it has none.
+		 */
+		std::size_t getAgentProfile(std::size_t agentNo) const;
+
+		/**
+		 * \brief      Returns the number of a named agent profile.
+		 * \param[in]  name  The name of the profile.
+		 * \return     The number of the profile.
+		 */
+		std::size_t getAgentProfileNo(const std::string &name) const;
+
         Vector2 getAgentPrefVelocity(std::size_t agentNo) const;
 
 		/**
@@ -208,7 +464,20 @@ namespace hrvo {
 		 */
 		bool getAgentReachedGoal(std::size_t agentNo) const;
 
-#if HRVO_DIFFERENTIAL_DRIVE
+		/**
+		 * \brief      Returns the time horizon of a specified agent.
+		 *
+		 * \details    The time horizon is the amount of time for which the new
+		 *             velocity of an agent is guaranteed to be collision-free;
+		 *             velocity obstacles are truncated at the velocities that
+		 *             collide at the time horizon, and those of neighbors that
+		 *             cannot be reached within it are ignored.
+		 *
+		 * \param[in]  agentNo  The number of the agent whose time horizon is to be retrieved.
+		 * \return     The present time horizon of the agent.
+		 */
+		float getAgentTimeHorizon(std::size_t agentNo) const;
+
 		/**
 		 * \brief      Returns the right wheel speed of a specified agent.
 		 * \param[in]  agentNo  The number of the agent whose right wheel speed is to be retrieved.
@@ -227,7 +496,6 @@ namespace hrvo {
 		 * \return     The present time to orientation of the agent.
 		 */
 		float getAgentTimeToOrientation(std::size_t agentNo) const;
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
 
 		/**
 		 * \brief      Returns the "uncertainty offset" of a specified agent.
@@ -248,33 +516,94 @@ namespace hrvo {
 		 */
 		Vector2 getAgentVelocity(std::size_t agentNo) const;
 
-#if HRVO_DIFFERENTIAL_DRIVE
+		/**
+		 * \brief      Copies the velocities of consecutive agents into an array, all from the same step.
+		 * \param[in]  agentNo     The number of the first agent.
+		 * \param[in]  numAgents   The count of agents.
+		 * \param[out] velocities  The array of at least numAgents elements into which the present velocities of the agents are copied.
+		 */
+		void getAgentVelocities(std::size_t agentNo, std::size_t numAgents, Vector2 *velocities) const;
+
 		/**
 		 * \brief      Returns the wheel track of a specified agent.
 		 * \param[in]  agentNo  The number of the agent whose wheel track is to be retrieved.
 		 * \return     The present wheel track of the agent.
 		 */
 		float getAgentWheelTrack(std::size_t agentNo) const;
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
 
 		/**
 		 * \brief   Returns the global time of the simulation.
 		 * \return  The present global time of the simulation (zero initially).
 		 */
-		float getGlobalTime() const { return globalTime_; }
+		float getGlobalTime() const;
 
 		/**
 		 * \brief      Returns the position of a specified goal.
 		 * \param[in]  goalNo  The number of the goal whose position is to be retrieved.
-		 * \return     The position of the goal.
+		 * \return     The position of the goal, which is that of its last waypoint.
 		 */
 		Vector2 getGoalPosition(std::size_t goalNo) const;
 
 		/**
-		 * \brief   Returns the count of agents in the simulation.
-		 * \return  The count of agents in the simulation.
+		 * \brief   Returns the maximum time after which an agent decides its velocity again.
+		 * \return  The present maximum decision interval.
 		 */
-		std::size_t getNumAgents() const { return agents_.size(); }
+		float getMaxDecisionInterval() const { return maxDecisionInterval_; }
+
+		/**
+		 * \brief   Returns the minimum time after which an agent decides its velocity again.
+		 * \return  The present minimum decision interval.
+		 */
+		float getMinDecisionInterval() const { return minDecisionInterval_; }
+
+		/**
+		 * \brief   Returns the minimum sub-step of an adaptive time step.
+		 * \return  The present minimum sub-step.
+		 */
+		float getMinSubStep() const { return minSubStep_; }
+
+		/**
+		 * \brief      Returns whether the navigation grid cell that contains a position is blocked.
+		 * \param[in]  position  The position.
+		 * \return     True if the cell is blocked; false if it is free, the position lies outside the grid, or there is no navigation grid.
+		 */
+		bool getNavigationGridCellBlocked(const Vector2 &position) const;
+
+		/**
+		 * \brief   Returns the count of agent numbers in the simulation, which includes the numbers of removed agents that await reuse.
+		 * \return  The count of agent numbers, below which every agent number lies.
+		 */
+		std::size_t getNumAgents() const;
+
+		/**
+		 * \brief   Returns the count of agent profiles in the simulation.
+		 * \return  The count of agent profiles in the simulation.
+		 */
+		std::size_t getNumAgentProfiles() const { return profiles_.size(); }
+
+		/**
+		 * \brief   Returns the maximum number of agents for which neighbors are computed by brute force rather than with a k-D tree.
+		 * \return  The present brute-force neighbor threshold, which takes effect once automatic tuning of the neighbor index is disabled if it is enabled.
+		 */
+		std::size_t getNeighborBruteForceThreshold() const;
+
+		/**
+		 * \brief   Returns whether the neighbor index is tuned automatically.
+		 * \return  True if the neighbor index is tuned automatically; false otherwise.
+		 */
+		bool getNeighborAutoTuning() const { return neighborTuner_ != NULL; }
+
+		/**
+		 * \brief   Returns whether neighbors are found and ranked by the distance between the surfaces of agents rather than between their centers.
+		 * \return  True if surface distances are used; false otherwise.
+		 */
+		bool getNeighborSurfaceDistance() const;
+
+		/**
+		 * \brief   Returns the count of agents in the simulation that have not been removed.
+		 * \return  The count of agents that have not been removed.
+		 */
+		std::size_t getNumLiveAgents() const;
 
 		/**
 		 * \brief   Returns the count of goals in the simulation.
@@ -282,17 +611,113 @@ namespace hrvo {
 		 */
 		std::size_t getNumGoals() const { return goals_.size(); }
 
+		/**
+		 * \brief   Returns the number of threads that run each simulation step.
+		 * \return  The number of threads that run each simulation step.
+		 */
+		std::size_t getNumThreads() const;
+
+		/**
+		 * \brief   Returns the overlap tolerance of an adaptive time step.
+		 * \return  The present overlap tolerance, or zero if the time step is not adaptive.
+		 */
+		float getOverlapTolerance() const { return overlapTolerance_; }
+
+		/**
+		 * \brief   Returns the sub-steps taken by the last simulation step.
+		 * \return  The time steps of the sub-steps, in order, which sum to the time step of the simulation.
+		 */
+		const std::vector<float> &getSubSteps() const { return subSteps_; }
+
 		/**
 		 * \brief   Returns the time step of the simulation.
 		 * \return  The present time step of the simulation.
 		 */
 		float getTimeStep() const { return timeStep_; }
 
+		/**
+		 * \brief      Returns whether the agent identified by a handle is in the simulation.
+		 * \param[in]  handle  The handle of the agent.
+		 * \return     True if the agent has been added and not removed; false otherwise.
+		 */
+		bool hasAgent(const AgentHandle &handle) const;
+
 		/**
 		 * \brief   Returns the progress towards their goals of all agents.
 		 * \return  True if all agents have reached their goals; false otherwise.
 		 */
-		bool haveReachedGoals() const { return reachedGoals_; }
+		bool haveReachedGoals() const;
+
+		/**
+		 * \brief      Moves each agent towards its new velocity over a time step, then updates the progress of each towards its goal and advances the global time; the final stage of a simulation step.
+		 * \param[in]  timeStep  The time step over which to move the agents.
+		 */
+		void integrate(float timeStep);
+
+		/**
+		 * \brief      Removes an agent from the simulation.
+		 *
+		 * \details    The agent stops at once and is no longer a neighbor of
+		 *             any agent from the next neighbor computation. Its number
+		 *             stays reserved, reporting its last position at rest and
+		 *             its goal as reached, until the next agent added reuses it,
+		 *             so that the numbers of the other agents do not change.
+		 *
+		 * \param[in]  handle  The handle of the agent.
+		 */
+		void removeAgent(const AgentHandle &handle);
+
+		/**
+		 * \brief      Restores the simulation to the state saved in a snapshot.
+		 *
+		 * \details    Agents and goals are added or removed to match the count
+		 *             in the snapshot, then every agent and goal, the global
+		 *             time, the time step and its adaptive and decision interval
+		 *             settings, and the agent defaults are overwritten. The
+		 *             neighbors and new velocity of each agent are recomputed by
+		 *             the next call to doStep() or buildIndex() and
+		 *             computeVelocities(). The configuration of the k-D tree
+		 *             and the count of threads are not restored.
+		 *
+		 * \param[in]  snapshot  The snapshot to restore.
+		 */
+		void restoreSnapshot(const Snapshot &snapshot);
+
+		/**
+		 * \brief          Runs rollouts in parallel, each on a clone of the simulation with the goals assigned to it, and records their summary metrics.
+		 *
+		 * \details        Each rollout steps its clone until all agents have
+		 *                 reached their goals or the duration has elapsed. The
+		 *                 rollouts are distributed among the threads of the
+		 *                 simulation, and this simulation is not modified.
+		 *
+		 * \param[in,out]  rollouts  The rollouts to run.
+		 * \param[in]      duration  The longest time to simulate ahead.
+		 */
+		void runRollouts(std::vector<Rollout> &rollouts, float duration) const;
+
+		/**
+		 * \brief      Saves the state of the simulation to a snapshot, which reuses its memory if it has held a simulation of the same size.
+		 * \param[out] snapshot  The snapshot to which to save the state.
+		 */
+		void saveSnapshot(Snapshot &snapshot) const;
+
+		/**
+		 * \brief      Sets the time step of the simulation to adapt to the encounters between agents.
+		 *
+		 * \details    Each simulation step is divided into the fewest equal
+		 *             sub-steps, each no shorter than the minimum sub-step, such
+		 *             that no two neighbors moving at their new velocities are
+		 *             predicted to overlap by more than the tolerance within a
+		 *             sub-step. The neighbors and new velocities are recomputed
+		 *             before each sub-step, and agents that overlap a neighbor
+		 *             separate within the sub-step. A tolerance of zero, the
+		 *             default, disables sub-steps.
+		 *
+		 * \param[in]  overlapTolerance  The overlap tolerance.
+		 * \param[in]  minSubStep        The minimum sub-step.
+		 */
+		void setAdaptiveTimeStep(float overlapTolerance, float minSubStep);
 
 		/**
 		 * \brief      Sets the default properties for any new agent that is added.
@@ -306,21 +731,59 @@ namespace hrvo {
 		 * \param[in]  maxAccel           The default maximum acceleration of a new agent.
 		 * \param[in]  velocity           The default initial velocity of a new agent.
 		 * \param[in]  orientation        The default initial orientation (in radians) of a new agent.
+		 * \param[in]  timeHorizon        The default time horizon of a new agent.
+		 * \param[in]  clusterDist        The default cluster distance of a new agent.
+		 */
+		void setAgentDefaults(float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset = 0.0f, float maxAccel = std::numeric_limits<float>::infinity(), const Vector2 &velocity = Vector2(), float orientation = 0.0f, float timeHorizon = std::numeric_limits<float>::infinity(), float clusterDist = std::numeric_limits<float>::infinity());
+
+		/**
+		 * \brief      Sets the default kinematic model of a new agent, which is holonomic unless it is set, keeping the default time to orientation and wheel track; throws for the differential-drive model unless they have been set.
+		 * \param[in]  kinematics  The default kinematic model of a new agent.
+		 */
+		void setAgentDefaultKinematics(KinematicModel kinematics);
+
+		/**
+		 * \brief      Sets the default kinematic model, time to orientation, and wheel track of a new agent; throws unless the time to orientation and wheel track are positive.
+		 * \param[in]  kinematics         The default kinematic model of a new agent.
+		 * \param[in]  timeToOrientation  The default time to orientation of a new differential-drive agent.
+		 * \param[in]  wheelTrack         The default wheel track of a new differential-drive agent.
+		 */
+		void setAgentDefaultKinematics(KinematicModel kinematics, float timeToOrientation, float wheelTrack);
+
+		/**
+		 * \brief      Sets the cluster distance of a specified agent.
+		 *
+		 * \details    Neighbors beyond the cluster distance that lie in similar
+		 *             directions and move with similar velocities are merged
+		 *             into a single conservative velocity obstacle, which bounds
+		 *             the cost of computing the new velocity in dense crowds.
+		 *             Infinite unless set by the agent defaults or the agent
+		 *             profile, which disables clustering.
+		 *
+		 * \param[in]  agentNo      The number of the agent whose cluster distance is to be modified.
+		 * \param[in]  clusterDist  The replacement cluster distance.
 		 */
-		void setAgentDefaults(float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed,
-#if HRVO_DIFFERENTIAL_DRIVE
-			float timeToOrientation, float wheelTrack,
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
-			float uncertaintyOffset = 0.0f, float maxAccel = std::numeric_limits<float>::infinity(), const Vector2 &velocity = Vector2(), float orientation = 0.0f);
+		void setAgentClusterDist(std::size_t agentNo, float clusterDist);
 
 		/**
-		 * \brief      Sets the goal number of a specified agent.
+		 * \brief      Sets the goal number of a specified agent, which then starts from the first waypoint of the goal; throws if the goal does not exist.
 		 * \param[in]  agentNo  The number of the agent whose goal number is to be modified.
 		 * \param[in]  goalNo   The replacement goal number.
 		 */
 		void setAgentGoal(std::size_t agentNo, std::size_t goalNo);
 
-        void setAgentGoalPosition(size_t agentNo, Vector2 position);
+		/**
+		 * \brief      Sets the goal of a specified agent to a goal at a position.
+		 *
+		 * \details    The first call for an agent number adds a goal, which later
+		 *             calls for that number move rather than add another, so
+		 *             that repeated calls do not grow the simulation. Any other
+		 *             agent set to that goal moves with it.
+		 *
+		 * \param[in]  agentNo   The number of the agent whose goal is to be modified.
+		 * \param[in]  position  The position of the replacement goal.
+		 */
+		void setAgentGoalPosition(std::size_t agentNo, const Vector2 &position);
 
 		/**
 		 * \brief      Sets the goal radius of a specified agent.
@@ -329,6 +792,17 @@ namespace hrvo {
 		 */
 		void setAgentGoalRadius(std::size_t agentNo, float goalRadius);
 
+		/**
+		 * \brief      Sets the kinematic model of a specified agent.
+		 *
+		 * \details    A differential-drive agent also needs a positive time to
+		 *             orientation and wheel track, without which this throws.
+		 *
+		 * \param[in]  agentNo     The number of the agent whose kinematic model is to be modified.
+		 * \param[in]  kinematics  The replacement kinematic model.
+		 */
+		void setAgentKinematics(std::size_t agentNo, KinematicModel kinematics);
+
 		/**
 		 * \brief      Sets the maximum linear acceleraton of a specified agent.
 		 * \param[in]  agentNo   The number of the agent whose maximum acceleration is to be modified.
@@ -382,6 +856,47 @@ namespace hrvo {
 		 */
 		void setAgentPrefSpeed(std::size_t agentNo, float prefSpeed);
 
+		/**
+		 * \brief      Assigns an agent profile to a specified agent, which takes all of the properties of the profile.
+		 * \param[in]  agentNo    The number of the agent whose agent profile is to be modified.
+		 * \param[in]  profileNo  The number of the replacement agent profile.
+		 */
+		void setAgentProfile(std::size_t agentNo, std::size_t profileNo);
+
+		/**
+		 * \brief      Sets the kinematic model of an agent profile and of each agent with the profile that has not overridden it, keeping the time to orientation and wheel track of the profile; throws for the differential-drive model unless they have been set.
+		 * \param[in]  profileNo   The number of the profile.
+		 * \param[in]  kinematics  The kinematic model of an agent with the profile.
+		 */
+		void setAgentProfileKinematics(std::size_t profileNo, KinematicModel kinematics);
+
+		/**
+		 * \brief      Sets the kinematic model, time to orientation, and wheel track of an agent profile and of each agent with the profile that has not overridden them; throws unless the time to orientation and wheel track are positive.
+		 * \param[in]  profileNo          The number of the profile.
+		 * \param[in]  kinematics         The kinematic model of an agent with the profile.
+		 * \param[in]  timeToOrientation  The time to orientation of a differential-drive agent with the profile.
+		 * \param[in]  wheelTrack         The wheel track of a differential-drive agent with the profile.
+		 */
+		void setAgentProfileKinematics(std::size_t profileNo, KinematicModel kinematics, float timeToOrientation, float wheelTrack);
+
+		/**
+		 * \brief      Sets the properties of an agent profile and of each agent with the profile that has not overridden them.
+		 * \param[in]  profileNo          The number of the profile.
+		 * \param[in]  neighborDist       The maximum neighbor distance of an agent with the profile.
+		 * \param[in]  maxNeighbors       The maximum neighbor count of an agent with the profile.
+		 * \param[in]  radius             The radius of an agent with the profile.
+		 * \param[in]  goalRadius         The goal radius of an agent with the profile.
+		 * \param[in]  prefSpeed          The preferred speed of an agent with the profile.
+		 * \param[in]  maxSpeed           The maximum speed of an agent with the profile.
+		 * \param[in]  uncertaintyOffset  The uncertainty offset of an agent with the profile.
+		 * \param[in]  maxAccel           The maximum acceleration of an agent with the profile.
+		 * \param[in]  velocity           The initial velocity of a new agent with the profile.
+		 * \param[in]  orientation        The initial orientation (in radians) of a new agent with the profile.
+		 * \param[in]  timeHorizon        The time horizon of an agent with the profile.
+		 * \param[in]  clusterDist        The cluster distance of an agent with the profile.
+		 */
+		void setAgentProfileProperties(std::size_t profileNo, float neighborDist, std::size_t maxNeighbors, float radius, float goalRadius, float prefSpeed, float maxSpeed, float uncertaintyOffset = 0.0f, float maxAccel = std::numeric_limits<float>::infinity(), const Vector2 &velocity = Vector2(), float orientation = 0.0f, float timeHorizon = std::numeric_limits<float>::infinity(), float clusterDist = std::numeric_limits<float>::infinity());
+
 		/**
 		 * \brief      Sets the radius of a specified agent.
 		 * \param[in]  agentNo  The number of the agent whose radius is to be modified.
@@ -389,13 +904,27 @@ namespace hrvo {
 		 */
 		void setAgentRadius(std::size_t agentNo, float radius);
 
-#if HRVO_DIFFERENTIAL_DRIVE
+		/**
+		 * \brief      Sets the time horizon of a specified agent.
+		 *
+		 * \details    The time horizon is the amount of time for which the new
+		 *             velocity of an agent is guaranteed to be collision-free;
+		 *             velocity obstacles are truncated at the velocities that
+		 *             collide at the time horizon, and those of neighbors that
+		 *             cannot be reached within it are ignored. Smaller values reduce
+		 *             the number of velocity obstacles and candidate points.
+		 *
+		 * \param[in]  agentNo      The number of the agent whose time horizon is to be modified.
+		 * \param[in]  timeHorizon  The replacement time horizon.
+		 */
+		void setAgentTimeHorizon(std::size_t agentNo, float timeHorizon);
+
 		/**
 		 * \brief      Sets the "time to orientation" of a specified agent.
 		 *
 		 * \details    The time to orientation is the time period that a
 		 *             differential-drive agent is given to assume the orientation
-		 *             defined by its new velocity.
+		 *             defined by its new velocity, and must be positive.
 		 *
 		 * \param[in]  agentNo            The number of the agent whose time to orientation is to be modified.
 		 * \param[in]  timeToOrientation  The replacement time to orientation.
@@ -403,12 +932,11 @@ namespace hrvo {
 		void setAgentTimeToOrientation(std::size_t agentNo, float timeToOrientation);
 
 		/**
-		 * \brief      Sets the wheel track of a specified agent.
+		 * \brief      Sets the wheel track of a specified agent, which must be positive.
 		 * \param[in]  agentNo     The number of the agent whose wheel track is to be modified.
 		 * \param[in]  wheelTrack  The replacement wheel track.
 		 */
 		void setAgentWheelTrack(std::size_t agentNo, float wheelTrack);
-#endif /* HRVO_DIFFERENTIAL_DRIVE */
 
 		/**
 		 * \brief      Sets the "uncertainty offset" of a specified agent.
@@ -429,6 +957,115 @@ namespace hrvo {
 		 */
 		void setAgentVelocity(std::size_t agentNo, const Vector2 &velocity);
 
+		/**
+		 * \brief      Sets the velocities of consecutive agents from an array, publishing them once.
+		 * \param[in]  agentNo     The number of the first agent.
+		 * \param[in]  numAgents   The count of agents.
+		 * \param[in]  velocities  The array of at least numAgents replacement velocities.
+		 */
+		void setAgentVelocities(std::size_t agentNo, std::size_t numAgents, const Vector2 *velocities);
+
+		/**
+		 * \brief      Sets the bounds on the time after which an agent decides its velocity again.
+		 *
+		 * \details    Each agent decides its velocity again after half the time
+		 *             to its nearest collision, clamped to these bounds; until
+		 *             then, its neighbors and new velocity are not recomputed
+		 *             and it keeps moving towards its last new velocity. With a
+		 *             maximum of zero, the default, every agent decides its
+		 *             velocity at every step. Every agent decides its velocity
+		 *             at the next step after the bounds are set, and an agent
+		 *             does so after its goal, position, or velocity is set.
+		 *
+		 * \param[in]  minInterval  The minimum decision interval.
+		 * \param[in]  maxInterval  The maximum decision interval.
+		 */
+		void setDecisionIntervals(float minInterval, float maxInterval);
+
+		/**
+		 * \brief      Sets the navigation grid over which agents find their way around static obstacles to their waypoints.
+		 *
+		 * \details    Each cell of the grid is free until blocked. For each cell
+		 *             that holds a waypoint, the shortest paths from every cell
+		 *             to it are computed once, when the first agent heads to a
+		 *             waypoint in it, shared by every agent heading to a
+		 *             waypoint in it, and dropped once no agent does; each agent
+		 *             then prefers to move along the path from its position
+		 *             rather than straight towards its waypoint, until it is
+		 *             within a cell of the waypoint. Replaces any previous grid;
+		 *             set zero columns or rows to remove it.
+		 *
+		 * \param[in]  origin      The position of the corner of the grid with the smallest coordinates.
+		 * \param[in]  numColumns  The number of columns of cells, along the x-axis.
+		 * \param[in]  numRows     The number of rows of cells, along the y-axis.
+		 * \param[in]  cellSize    The width of a cell.
+		 */
+		void setNavigationGrid(const Vector2 &origin, std::size_t numColumns, std::size_t numRows, float cellSize);
+
+		/**
+		 * \brief      Blocks or frees the navigation grid cell that contains a position.
+		 *
+		 * \details    The shortest paths already computed are repaired rather
+		 *             than recomputed, so that doors and moving obstacles can
+		 *             be modeled by blocking and freeing cells between steps.
+		 *
+		 * \param[in]  position  The position.
+		 * \param[in]  blocked   True to block the cell; false to free it.
+		 */
+		void setNavigationGridCellBlocked(const Vector2 &position, bool blocked);
+
+		/**
+		 * \brief      Sets whether the neighbor index is tuned automatically.
+		 *
+		 * \details    When enabled, the first steps of the simulation time the
+		 *             computation of neighbors with brute force and with k-D
+		 *             trees of several leaf sizes and split rules, and then use
+		 *             the fastest. Tuning restarts when the count or density of
+		 *             agents changes significantly. The neighbors found do not
+		 *             depend on the configuration, only the time taken to find
+		 *             them. Overrides the brute-force neighbor threshold, which
+		 *             is restored, with any change made to it meanwhile, once
+		 *             tuning is disabled.
+		 *
+		 * \param[in]  autoTuning  True to tune the neighbor index automatically; false otherwise.
+		 */
+		void setNeighborAutoTuning(bool autoTuning);
+
+		/**
+		 * \brief      Sets the maximum number of agents for which neighbors are computed by brute force rather than with a k-D tree.
+		 *
+		 * \details    For small simulations, computing the distances to all
+		 *             agents from packed positions is faster than building and
+		 *             traversing a k-D tree. Set to zero to always use the k-D
+		 *             tree.
+		 *
+		 * \param[in]  numAgents  The replacement brute-force neighbor threshold.
+		 */
+		void setNeighborBruteForceThreshold(std::size_t numAgents);
+
+		/**
+		 * \brief      Sets whether neighbors are found and ranked by the distance between the surfaces of agents rather than between their centers.
+		 *
+		 * \details    With surface distances, the maximum neighbor distance and
+		 *             cluster distance of each agent are measured between the
+		 *             surfaces of agents, so that large agents are found without
+		 *             increasing the maximum neighbor distance of every agent.
+		 *
+		 * \param[in]  surfaceDistance  True to use surface distances; false to use center distances.
+		 */
+		void setNeighborSurfaceDistance(bool surfaceDistance);
+
+		/**
+		 * \brief      Sets the number of threads that run each simulation step.
+		 *
+		 * \details    Each agent is stepped by exactly the same computations
+		 *             whatever the number of threads, so that trajectories are
+		 *             bit-identical to those of a single thread.
+		 *
+		 * \param[in]  numThreads  The number of threads, including the calling thread, or zero for one thread per hardware thread.
+		 */
+		void setNumThreads(std::size_t numThreads);
+
 		/**
 		 * \brief      Sets the time step of the simulation.
 		 * \param[in]  timeStep  The replacement time step of the simulation.
@@ -440,19 +1077,146 @@ namespace hrvo {
 		Simulator(const Simulator &other);
 		Simulator &operator=(const Simulator &other);
 
+		/**
+		 * \brief  The goal of an agent number to which no goal has been set by position.
+		 */
+		static const std::size_t HRVO_NO_GOAL = static_cast<std::size_t>(-1);
+
+		/**
+		 * \brief  The number of the parameters of the agent defaults before they are set.
+		 */
+		static const std::size_t HRVO_NO_PARAMETERS = static_cast<std::size_t>(-1);
+
+		/**
+		 * \brief      Adds parameters to the parameter table, reusing the slot of parameters that no agent uses if there is one.
+		 * \param[in]  parameters  The parameters to be added, whose user count starts at zero.
+		 * \return     The number of the parameters.
+		 */
+		std::size_t addParameters(const AgentParameters &parameters);
+
+		/**
+		 * \brief      Copies the properties of an agent profile that they have not overridden to the parameters of its own of each agent with the profile.
+		 * \param[in]  profileNo  The number of the profile.
+		 */
+		void applyProfile(std::size_t profileNo);
+
+		/**
+		 * \brief      Checks that parameters of the differential-drive model have a positive time to orientation and wheel track.
+		 * \param[in]  parameters  The parameters, as they would be once set.
+		 * \param[in]  action      The action setting the parameters, which completes the message of the exception thrown otherwise.
+		 */
+		static void checkDifferentialDrive(const AgentParameters &parameters, const char *action);
+
+		/**
+		 * \brief      Computes the longest sub-step that divides the remainder of a simulation step into equal sub-steps within which no two neighbors are predicted to overlap by more than the tolerance.
+		 * \param[in]  remainder  The remainder of the simulation step.
+		 * \return     The sub-step.
+		 */
+		float computeSubStep(float remainder);
+
+		/**
+		 * \brief      Computes the preferred velocity and the new velocity of each agent.
+		 * \param[in]  timeStep  The time over which the new velocities are applied.
+		 */
+		void computeVelocities(float timeStep);
+
+		/**
+		 * \brief      Determines whether all agents have reached their goals, advances the global time, and publishes the state of the completed step.
+		 * \param[in]  timeStep  The time by which to advance the global time.
+		 */
+		void finishStep(float timeStep);
+
+		/**
+		 * \brief  Groups the agents that have not been removed by their kinematic models, so that each group is integrated without dispatching on the model of each agent.
+		 */
+		void groupAgentsByKinematics();
+
+		/**
+		 * \brief      Inserts a new agent, reusing the number of the last agent removed if there is one.
+		 * \param[in]  agent  A pointer to the agent, which the simulation then owns.
+		 * \return     The number of the agent.
+		 */
+		std::size_t insertAgent(Agent *agent);
+
+		/**
+		 * \brief      Releases parameters for one of their users, freeing their slot once they have none.
+		 * \param[in]  parametersNo  The number of the parameters.
+		 */
+		void releaseParameters(std::size_t parametersNo);
+
+		/**
+		 * \brief      Computes the new velocity again of each agent that decided its velocity at the last call to computeVelocities() and overlaps a neighbor, separating within a shorter time.
+		 * \param[in]  timeStep  The time over which the new velocities are applied.
+		 */
+		void separateOverlaps(float timeStep);
+
+		/**
+		 * \brief          Gives a user of parameters a copy of its own if any other agent, profile, or the agent defaults shares them.
+		 * \param[in,out]  parametersNo  The number of the parameters of the user, which is replaced by the number of the copy.
+		 * \return         The parameters of the user, which may be modified.
+		 */
+		AgentParameters &unshareParameters(std::size_t &parametersNo);
+
+		/**
+		 * \brief   Returns the parameter table to be modified, first copying it if it is shared with a clone or snapshot.
+		 * \return  The parameter table.
+		 */
+		std::vector<AgentParameters> &writeParameterTable();
+
+		/**
+		 * \brief      Returns parameters to be modified in place for all of their users.
+		 * \param[in]  parametersNo  The number of the parameters.
+		 * \return     The parameters.
+		 */
+		AgentParameters &writeParameters(std::size_t parametersNo);
+
+		/**
+		 * \brief   Returns the waypoint pool to be modified, first copying it if it is shared with a clone.
+		 * \return  The waypoint pool.
+		 */
+		std::vector<Vector2> &writeWaypoints();
+
 
 
-		Agent *defaults_;
 		KdTree *kdTree_;
+		NavigationGrid *navigationGrid_;
+		NeighborTuner *neighborTuner_;
+		StateBuffer *stateBuffer_;
+		ThreadPool *threadPool_;
 		float globalTime_;
+		float maxDecisionInterval_;
+		float minDecisionInterval_;
+		float minSubStep_;
+		float overlapTolerance_;
 		float timeStep_;
+		std::size_t defaultsNo_;
+		bool kinematicsChanged_;
 		bool reachedGoals_;
 		std::vector<Agent *> agents_;
-		std::vector<Goal *> goals_;
+		std::vector<std::size_t> differentialDriveAgents_;
+		std::vector<std::size_t> freeAgentNos_;
+		std::vector<std::size_t> freeParametersNos_;
+		std::vector<Goal> goals_;
+		std::vector<std::size_t> holonomicAgents_;
+		std::vector<std::size_t> numParametersUsers_;
+		std::vector<std::size_t> omnidirectionalAgents_;
+		std::shared_ptr<std::vector<AgentParameters> > parameters_;
+		std::vector<std::size_t> positionGoalNos_;
+		std::vector<std::string> profileNames_;
+		std::vector<std::size_t> profiles_;
+		std::vector<std::size_t> quiescentSteps_;
+		std::vector<char> separating_;
+		std::vector<float> subSteps_;
+		std::vector<float> timesToOverlap_;
+		std::shared_ptr<std::vector<Vector2> > waypoints_;
 
 		friend class Agent;
 		friend class Goal;
 		friend class KdTree;
+		friend class NavigationGrid;
+		friend class NeighborTuner;
+		friend class StateBuffer;
+		friend class ThreadPool;
     };
 }
 
@@ -0,0 +1,45 @@
+/*
+ * Snapshot.cpp
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   Snapshot.cpp
+ * \brief  Defines the Snapshot class.
+ */
+
+#include "Snapshot.h"
+
+#include "AgentParameters.h"
+#include "Simulator.h"
+
+namespace hrvo {
+	Snapshot::Snapshot() : parameters_(std::make_shared<std::vector<AgentParameters> >()), defaultsNo_(Simulator::HRVO_NO_PARAMETERS), globalTime_(0.0f), maxDecisionInterval_(0.0f), minDecisionInterval_(0.0f), minSubStep_(0.0f), overlapTolerance_(0.0f), timeStep_(0.0f), reachedGoals_(false) { }
+}
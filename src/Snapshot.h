@@ -0,0 +1,233 @@
+/*
+ * Snapshot.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   Snapshot.h
+ * \brief  Declares the Snapshot class.
+ */
+
+#ifndef HRVO_SNAPSHOT_H_
+#define HRVO_SNAPSHOT_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Export.h"
+#include "Vector2.h"
+
+namespace hrvo {
+	class AgentParameters;
+	class Simulator;
+	class Trajectory;
+
+	/**
+	 * \class    Snapshot
+	 * \brief    The complete state of a simulation, saved by Simulator::saveSnapshot() and restored by Simulator::restoreSnapshot().
+	 *
+	 * \details  The state is held in flat arrays that keep their capacity, so
+	 *           saving to or restoring from a snapshot that has held a
+	 *           simulation of the same size allocates no memory. The
+ *           parameters that agents share are immutable once saved, so the
+ *           snapshot shares them with the simulation rather than copying them.
+	 */
+	class HRVO_EXPORT Snapshot {
+	public:
+		/**
+		 * \brief  Constructor.
+		 */
+		Snapshot();
+
+		/**
+		 * \brief   Returns the global time of the saved simulation.
+		 * \return  The global time of the saved simulation.
+		 */
+		float getGlobalTime() const { return globalTime_; }
+
+		/**
+		 * \brief   Returns the count of agents in the saved simulation.
+		 * \return  The count of agents in the saved simulation.
+		 */
+		std::size_t getNumAgents() const { return agents_.size(); }
+
+		/**
+		 * \brief   Returns the count of goals in the saved simulation.
+		 * \return  The count of goals in the saved simulation.
+		 */
+		std::size_t getNumGoals() const { return goals_.size(); }
+
+	private:
+		/**
+		 * \class  AgentState
+		 * \brief  The saved state of an agent.
+		 */
+		class AgentState {
+		public:
+			/**
+			 * \brief  The new velocity of the agent.
+			 */
+			Vector2 newVelocity_;
+
+			/**
+			 * \brief  The position of the agent.
+			 */
+			Vector2 position_;
+
+			/**
+			 * \brief  The preferred velocity of the agent.
+			 */
+			Vector2 prefVelocity_;
+
+			/**
+			 * \brief  The velocity of the agent.
+			 */
+			Vector2 velocity_;
+
+			/**
+			 * \brief  The generation of the number of the agent.
+			 */
+			std::size_t generation_;
+
+			/**
+			 * \brief  The number of the goal of the agent.
+			 */
+			std::size_t goalNo_;
+
+			/**
+			 * \brief  The number of the parameters of the agent in the saved parameter table.
+			 */
+			std::size_t parametersNo_;
+
+			/**
+			 * \brief  The number of the profile of the agent.
+			 */
+			std::size_t profileNo_;
+
+			/**
+			 * \brief  The knot of the trajectory of the goal of the agent at which its last evaluation started.
+			 */
+			std::size_t knot_;
+
+			/**
+			 * \brief  The index of the present waypoint of the agent in the saved waypoints.
+			 */
+			std::size_t waypoint_;
+
+			/**
+			 * \brief  The global time at which the agent next decides its velocity.
+			 */
+			float nextDecisionTime_;
+
+			/**
+			 * \brief  The orientation of the agent.
+			 */
+			float orientation_;
+
+			/**
+			 * \brief  The left wheel speed of a differential-drive agent.
+			 */
+			float leftWheelSpeed_;
+
+			/**
+			 * \brief  The right wheel speed of a differential-drive agent.
+			 */
+			float rightWheelSpeed_;
+
+			/**
+			 * \brief  The properties set on the agent itself rather than by its profile.
+			 */
+			unsigned int overrides_;
+
+			/**
+			 * \brief  Whether the agent has reached its goal.
+			 */
+			bool reachedGoal_;
+
+			/**
+			 * \brief  Whether the agent has been removed and its number awaits reuse.
+			 */
+			bool removed_;
+
+			/**
+			 * \brief  The neighbors of the agent, saved only with decision intervals, when an agent whose decision is not due keeps those of its last decision.
+			 */
+			std::vector<std::pair<float, std::size_t> > neighbors_;
+		};
+
+		/**
+		 * \class  GoalState
+		 * \brief  The saved state of a goal.
+		 */
+		class GoalState {
+		public:
+			/**
+			 * \brief  The trajectory of the goal, which is immutable and so shared rather than copied, or NULL if the goal is a route.
+			 */
+			std::shared_ptr<const Trajectory> trajectory_;
+
+			/**
+			 * \brief  The index of the first waypoint of the goal in the saved waypoints.
+			 */
+			std::size_t begin_;
+
+			/**
+			 * \brief  The index past the last waypoint of the goal in the saved waypoints.
+			 */
+			std::size_t end_;
+		};
+
+		std::vector<AgentState> agents_;
+		std::vector<std::string> profileNames_;
+		std::vector<std::size_t> profiles_;
+		std::vector<std::size_t> freeAgentNos_;
+		std::vector<std::size_t> freeParametersNos_;
+		std::vector<GoalState> goals_;
+		std::vector<std::size_t> numParametersUsers_;
+		std::shared_ptr<std::vector<AgentParameters> > parameters_;
+		std::vector<std::size_t> positionGoalNos_;
+		std::vector<Vector2> waypoints_;
+		std::size_t defaultsNo_;
+		float globalTime_;
+		float maxDecisionInterval_;
+		float minDecisionInterval_;
+		float minSubStep_;
+		float overlapTolerance_;
+		float timeStep_;
+		bool reachedGoals_;
+
+		friend class Simulator;
+	};
+}
+
+#endif /* HRVO_SNAPSHOT_H_ */
@@ -0,0 +1,138 @@
+/*
+ * StateBuffer.cpp
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   StateBuffer.cpp
+ * \brief  Defines the StateBuffer class.
+ */
+
+#include "StateBuffer.h"
+
+#include <thread>
+
+#include "Agent.h"
+#include "Simulator.h"
+
+namespace hrvo {
+	StateBuffer::Reader::Reader(const StateBuffer &stateBuffer) : buffer_(NULL)
+	{
+		while (true) {
+			const std::size_t front = stateBuffer.front_;
+			buffer_ = const_cast<Buffer *>(&stateBuffer.buffers_[front]);
+			++buffer_->numReaders_;
+
+			// The buffer may have been swapped out, and be about to be written, before it was pinned.
+			if (stateBuffer.front_ == front) {
+				return;
+			}
+
+			--buffer_->numReaders_;
+		}
+	}
+
+	StateBuffer::StateBuffer(Simulator *simulator) : simulator_(simulator), front_(0)
+	{
+		buffers_[0].stale_ = false;
+	}
+
+	void StateBuffer::invalidate()
+	{
+		for (std::size_t i = 0; i < HRVO_STATE_BUFFER_COUNT; ++i) {
+			buffers_[i].stale_ = true;
+			buffers_[i].staleAgents_.clear();
+		}
+	}
+
+	void StateBuffer::invalidate(std::size_t agentNo)
+	{
+		for (std::size_t i = 0; i < HRVO_STATE_BUFFER_COUNT; ++i) {
+			if (!buffers_[i].stale_) {
+				if (buffers_[i].staleAgents_.size() < simulator_->agents_.size()) {
+					buffers_[i].staleAgents_.push_back(agentNo);
+				}
+				else {
+					buffers_[i].stale_ = true;
+					buffers_[i].staleAgents_.clear();
+				}
+			}
+		}
+	}
+
+	void StateBuffer::publish()
+	{
+		const std::size_t front = front_;
+		std::size_t back = (front + 1) % HRVO_STATE_BUFFER_COUNT;
+
+		// Readers pin a buffer only while they copy a value out of it, so waiting for one to be released is brief.
+		while (buffers_[back].numReaders_ != 0) {
+			back = (back + 1) % HRVO_STATE_BUFFER_COUNT;
+
+			if (back == front) {
+				back = (back + 1) % HRVO_STATE_BUFFER_COUNT;
+				std::this_thread::yield();
+			}
+		}
+
+		Buffer &buffer = buffers_[back];
+		buffer.agents_.resize(simulator_->agents_.size());
+
+		if (buffer.stale_) {
+			for (std::size_t agentNo = 0; agentNo < buffer.agents_.size(); ++agentNo) {
+				write(buffer, agentNo);
+			}
+		}
+		else {
+			for (std::vector<std::size_t>::const_iterator iter = buffer.staleAgents_.begin(); iter != buffer.staleAgents_.end(); ++iter) {
+				write(buffer, *iter);
+			}
+		}
+
+		buffer.staleAgents_.clear();
+		buffer.numLiveAgents_ = simulator_->agents_.size() - simulator_->freeAgentNos_.size();
+		buffer.globalTime_ = simulator_->globalTime_;
+		buffer.reachedGoals_ = simulator_->reachedGoals_;
+		buffer.stale_ = false;
+
+		front_ = back;
+	}
+
+	void StateBuffer::write(Buffer &buffer, std::size_t agentNo) const
+	{
+		const Agent *const agent = simulator_->agents_[agentNo];
+		AgentState &state = buffer.agents_[agentNo];
+		state.position_ = agent->position_;
+		state.prefVelocity_ = agent->prefVelocity_;
+		state.velocity_ = agent->velocity_;
+		state.orientation_ = agent->orientation_;
+		state.reachedGoal_ = agent->reachedGoal_;
+	}
+}
@@ -0,0 +1,217 @@
+/*
+ * StateBuffer.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   StateBuffer.h
+ * \brief  Declares the StateBuffer class.
+ */
+
+#ifndef HRVO_STATE_BUFFER_H_
+#define HRVO_STATE_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "Vector2.h"
+
+namespace hrvo {
+	class Simulator;
+
+	/**
+	 * \class  StateBuffer
+	 * \brief  Publishes the state of all agents at the last completed step so that it may be read without locking while the next step is computed.
+	 *
+	 * \details  The state is triple buffered. Readers pin the front buffer
+	 *           for the duration of a read, and the simulation writes a
+	 *           buffer that is neither the front buffer nor pinned before
+	 *           swapping it to the front with one atomic store.
+	 */
+	class StateBuffer {
+	private:
+		/**
+		 * \class  AgentState
+		 * \brief  The published state of an agent.
+		 */
+		class AgentState {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			AgentState() : orientation_(0.0f), reachedGoal_(false) { }
+
+			/**
+			 * \brief  The position of the agent.
+			 */
+			Vector2 position_;
+
+			/**
+			 * \brief  The preferred velocity of the agent.
+			 */
+			Vector2 prefVelocity_;
+
+			/**
+			 * \brief  The velocity of the agent.
+			 */
+			Vector2 velocity_;
+
+			/**
+			 * \brief  The orientation of the agent.
+			 */
+			float orientation_;
+
+			/**
+			 * \brief  Whether the agent has reached its goal.
+			 */
+			bool reachedGoal_;
+		};
+
+		/**
+		 * \class  Buffer
+		 * \brief  A published state of the simulation.
+		 */
+		class Buffer {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			Buffer() : numLiveAgents_(0), numReaders_(0), globalTime_(0.0f), reachedGoals_(false), stale_(true) { }
+
+			/**
+			 * \brief  The published states of the agents.
+			 */
+			std::vector<AgentState> agents_;
+
+			/**
+			 * \brief  The numbers of the agents whose states have changed since this buffer was written.
+			 */
+			std::vector<std::size_t> staleAgents_;
+
+			/**
+			 * \brief  The count of agents that have not been removed.
+			 */
+			std::size_t numLiveAgents_;
+
+			/**
+			 * \brief  The number of readers that have pinned this buffer.
+			 */
+			std::atomic<std::size_t> numReaders_;
+
+			/**
+			 * \brief  The global time of the simulation.
+			 */
+			float globalTime_;
+
+			/**
+			 * \brief  Whether all agents have reached their goals.
+			 */
+			bool reachedGoals_;
+
+			/**
+			 * \brief  Whether the states of all agents have changed since this buffer was written.
+			 */
+			bool stale_;
+		};
+
+		/**
+		 * \class  Reader
+		 * \brief  Pins the front buffer for as long as it exists.
+		 */
+		class Reader {
+		public:
+			/**
+			 * \brief      Constructor.
+			 * \param[in]  stateBuffer  The state buffer whose front buffer is to be pinned.
+			 */
+			explicit Reader(const StateBuffer &stateBuffer);
+
+			/**
+			 * \brief  Destructor.
+			 */
+			~Reader() { --buffer_->numReaders_; }
+
+			/**
+			 * \brief   Returns the pinned buffer.
+			 * \return  A pointer to the pinned buffer.
+			 */
+			const Buffer *operator->() const { return buffer_; }
+
+		private:
+			Reader(const Reader &other);
+			Reader &operator=(const Reader &other);
+
+			Buffer *buffer_;
+		};
+
+		/**
+		 * \brief  The number of buffers.
+		 */
+		static const std::size_t HRVO_STATE_BUFFER_COUNT = 3;
+
+		/**
+		 * \brief      Constructor.
+		 * \param[in]  simulator  The simulation.
+		 */
+		explicit StateBuffer(Simulator *simulator);
+
+		/**
+		 * \brief  Marks the states of all agents as changed.
+		 */
+		void invalidate();
+
+		/**
+		 * \brief      Marks the state of an agent as changed.
+		 * \param[in]  agentNo  The number of the agent.
+		 */
+		void invalidate(std::size_t agentNo);
+
+		/**
+		 * \brief  Writes the changed states to a buffer that no reader has pinned and makes it the front buffer.
+		 */
+		void publish();
+
+		/**
+		 * \brief          Writes the state of an agent to a buffer.
+		 * \param[in,out]  buffer   The buffer.
+		 * \param[in]      agentNo  The number of the agent.
+		 */
+		void write(Buffer &buffer, std::size_t agentNo) const;
+
+		Simulator *const simulator_;
+		Buffer buffers_[HRVO_STATE_BUFFER_COUNT];
+		std::atomic<std::size_t> front_;
+
+		friend class Simulator;
+	};
+}
+
+#endif /* HRVO_STATE_BUFFER_H_ */
@@ -0,0 +1,231 @@
+/*
+ * ThreadPool.cpp
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   ThreadPool.cpp
+ * \brief  Defines the ThreadPool class.
+ */
+
+#include "ThreadPool.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace hrvo {
+	ThreadPool::ThreadPool(std::size_t numThreads) : function_(NULL), next_(0), numTasks_(0), running_(false), count_(0), generation_(0), grainSize_(HRVO_THREAD_POOL_GRAIN_SIZE), numBusy_(0), stopping_(false), stoppingTasks_(false)
+	{
+		for (std::size_t i = 1; i < numThreads; ++i) {
+			workers_.push_back(std::thread(&ThreadPool::runWorker, this));
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		// Queued tasks may run parallel loops, so they are completed before the workers are stopped.
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stoppingTasks_ = true;
+		}
+
+		taskCondition_.notify_one();
+
+		if (taskThread_.joinable()) {
+			taskThread_.join();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+
+		startCondition_.notify_all();
+
+		for (std::vector<std::thread>::iterator iter = workers_.begin(); iter != workers_.end(); ++iter) {
+			iter->join();
+		}
+	}
+
+	bool ThreadPool::isTaskPending()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		return numTasks_ > 0 && std::this_thread::get_id() != taskThread_.get_id();
+	}
+
+	void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)> &function, std::size_t grainSize)
+	{
+		// The pool holds the state of a single loop, which another loop started meanwhile from any thread would overwrite.
+		if (running_.exchange(true)) {
+			throw std::runtime_error("Parallel loop already running when starting parallel loop.");
+		}
+
+		if (workers_.empty() || count <= grainSize) {
+			try {
+				for (std::size_t i = 0; i < count; ++i) {
+					function(i);
+				}
+			}
+			catch (...) {
+				running_ = false;
+				throw;
+			}
+
+			running_ = false;
+
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			function_ = &function;
+			count_ = count;
+			grainSize_ = grainSize;
+			next_ = 0;
+			numBusy_ = workers_.size();
+			++generation_;
+		}
+
+		startCondition_.notify_all();
+
+		runIterations();
+
+		// Workers may still be calling the function, which must outlive them even if an iteration has thrown.
+		std::unique_lock<std::mutex> lock(mutex_);
+		finishCondition_.wait(lock, [this] { return numBusy_ == 0; });
+		function_ = NULL;
+		running_ = false;
+
+		if (exception_ != NULL) {
+			std::exception_ptr exception = exception_;
+			exception_ = NULL;
+			lock.unlock();
+			std::rethrow_exception(exception);
+		}
+	}
+
+	std::future<void> ThreadPool::runAsync(const std::function<void()> &task)
+	{
+		std::packaged_task<void()> packagedTask(task);
+		std::future<void> future = packagedTask.get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			tasks_.push_back(std::move(packagedTask));
+			++numTasks_;
+
+			if (!taskThread_.joinable()) {
+				taskThread_ = std::thread(&ThreadPool::runTasks, this);
+			}
+		}
+
+		taskCondition_.notify_one();
+
+		return future;
+	}
+
+	void ThreadPool::runTasks()
+	{
+		while (true) {
+			std::packaged_task<void()> task;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				taskCondition_.wait(lock, [this] { return stoppingTasks_ || !tasks_.empty(); });
+
+				if (tasks_.empty()) {
+					return;
+				}
+
+				task = std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+
+			task();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				--numTasks_;
+			}
+		}
+	}
+
+	void ThreadPool::runIterations()
+	{
+		try {
+			for (std::size_t begin = next_.fetch_add(grainSize_); begin < count_; begin = next_.fetch_add(grainSize_)) {
+				const std::size_t end = begin + grainSize_ < count_ ? begin + grainSize_ : count_;
+
+				for (std::size_t i = begin; i < end; ++i) {
+					(*function_)(i);
+				}
+			}
+		}
+		catch (...) {
+			// The first exception is rethrown by the calling thread once all threads have finished; iterations not yet claimed are skipped.
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			if (exception_ == NULL) {
+				exception_ = std::current_exception();
+			}
+
+			next_ = count_;
+		}
+	}
+
+	void ThreadPool::runWorker()
+	{
+		std::size_t generation = 0;
+
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				startCondition_.wait(lock, [this, generation] { return stopping_ || generation_ != generation; });
+
+				if (stopping_) {
+					return;
+				}
+
+				generation = generation_;
+			}
+
+			runIterations();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				if (--numBusy_ == 0) {
+					finishCondition_.notify_one();
+				}
+			}
+		}
+	}
+}
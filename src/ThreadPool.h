@@ -0,0 +1,148 @@
+/*
+ * ThreadPool.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   ThreadPool.h
+ * \brief  Declares the ThreadPool class.
+ */
+
+#ifndef HRVO_THREAD_POOL_H_
+#define HRVO_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hrvo {
+	/**
+	 * \class  ThreadPool
+	 * \brief  A fixed set of worker threads that run loops over agents in parallel, and a thread that runs tasks in the background.
+	 */
+	class ThreadPool {
+	private:
+		/**
+		 * \brief  The default number of loop iterations claimed by a thread at a time.
+		 */
+		static const std::size_t HRVO_THREAD_POOL_GRAIN_SIZE = 8;
+
+		/**
+		 * \brief      Constructor.
+		 * \param[in]  numThreads  The number of threads, including the calling thread, that run each loop.
+		 */
+		explicit ThreadPool(std::size_t numThreads);
+
+		/**
+		 * \brief  Destructor.
+		 */
+		~ThreadPool();
+
+		/**
+		 * \brief   Returns the number of threads, including the calling thread, that run each loop.
+		 * \return  The number of threads.
+		 */
+		std::size_t getNumThreads() const { return workers_.size() + 1; }
+
+		/**
+		 * \brief   Returns whether a queued task has not yet completed and the calling thread is not the background thread that runs it.
+		 * \return  True if a task is pending on another thread; false otherwise.
+		 */
+		bool isTaskPending();
+
+		/**
+		 * \brief      Calls a function for each iteration of a loop, distributing the iterations among the threads, and returns once all iterations are complete.
+		 *
+		 * \details    Iterations may run in any order and on any thread, so the
+		 *             function must only write state owned by its iteration. If
+		 *             an iteration throws, the remaining iterations are skipped
+		 *             and the first exception is rethrown once every thread has
+		 *             finished. Throws if a loop is already running on the pool,
+		 *             whether from another thread or from within an iteration.
+		 *
+		 * \param[in]  count      The number of iterations.
+		 * \param[in]  function   The function called with the number of each iteration.
+		 * \param[in]  grainSize  The number of iterations claimed by a thread at a time.
+		 */
+		void parallelFor(std::size_t count, const std::function<void(std::size_t)> &function, std::size_t grainSize = HRVO_THREAD_POOL_GRAIN_SIZE);
+
+		/**
+		 * \brief      Queues a task to be run on the background thread after all previously queued tasks.
+		 * \param[in]  task  The task, which may itself run parallel loops.
+		 * \return     A future that becomes ready, or holds the exception thrown by the task, once the task is complete.
+		 */
+		std::future<void> runAsync(const std::function<void()> &task);
+
+		/**
+		 * \brief  Runs the queued tasks on the background thread until the pool is destroyed and no tasks remain.
+		 */
+		void runTasks();
+
+		/**
+		 * \brief  Claims and runs iterations of the current loop until none remain.
+		 */
+		void runIterations();
+
+		/**
+		 * \brief  Runs the loops of the pool on a worker thread until the pool is destroyed.
+		 */
+		void runWorker();
+
+		std::vector<std::thread> workers_;
+		std::thread taskThread_;
+		std::deque<std::packaged_task<void()> > tasks_;
+		std::mutex mutex_;
+		std::condition_variable startCondition_;
+		std::condition_variable finishCondition_;
+		std::condition_variable taskCondition_;
+		const std::function<void(std::size_t)> *function_;
+		std::exception_ptr exception_;
+		std::atomic<std::size_t> next_;
+		std::size_t numTasks_;
+		std::atomic<bool> running_;
+		std::size_t count_;
+		std::size_t generation_;
+		std::size_t grainSize_;
+		std::size_t numBusy_;
+		bool stopping_;
+		bool stoppingTasks_;
+
+		friend class Simulator;
+	};
+}
+
+#endif /* HRVO_THREAD_POOL_H_ */
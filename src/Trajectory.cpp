@@ -0,0 +1,137 @@
+/*
+ * Trajectory.cpp
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   Trajectory.cpp
+ * \brief  Defines the Trajectory class.
+ */
+
+#include "Trajectory.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace hrvo {
+	/**
+	 * \brief  The default time over which an agent tracking a trajectory prefers to close the gap to its position.
+	 */
+	const float HRVO_TRAJECTORY_TRACKING_TIME = 0.25f;
+
+	Trajectory::Trajectory() : trackingTime_(HRVO_TRAJECTORY_TRACKING_TIME) { }
+
+	void Trajectory::addKnot(float time, const Vector2 &position, const Vector2 &velocity)
+	{
+		if (!times_.empty() && !(time > times_.back())) {
+			throw std::runtime_error("Knot time not later than previous knot when adding knot.");
+		}
+
+		positions_.push_back(position);
+		velocities_.push_back(velocity);
+		times_.push_back(time);
+	}
+
+	void Trajectory::evaluate(float time, std::size_t &knot, Vector2 &position, Vector2 &velocity) const
+	{
+		if (times_.empty()) {
+			position = Vector2(0.0f, 0.0f);
+			velocity = Vector2(0.0f, 0.0f);
+
+			return;
+		}
+
+		if (knot >= times_.size() || time < times_[knot]) {
+			knot = static_cast<std::size_t>(std::max(std::upper_bound(times_.begin(), times_.end(), time) - times_.begin(), static_cast<std::ptrdiff_t>(1))) - 1;
+		}
+
+		while (knot + 1 < times_.size() && times_[knot + 1] <= time) {
+			++knot;
+		}
+
+		if (knot + 1 == times_.size() || time < times_[knot]) {
+			position = positions_[knot];
+			velocity = Vector2(0.0f, 0.0f);
+
+			return;
+		}
+
+		const float duration = times_[knot + 1] - times_[knot];
+		const float s = (time - times_[knot]) / duration;
+		const float s2 = s * s;
+		const float s3 = s2 * s;
+
+		// Cubic Hermite basis functions and their derivatives with respect to s.
+		const float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+		const float h10 = s3 - 2.0f * s2 + s;
+		const float h01 = -2.0f * s3 + 3.0f * s2;
+		const float h11 = s3 - s2;
+		const float dh00 = 6.0f * s2 - 6.0f * s;
+		const float dh10 = 3.0f * s2 - 4.0f * s + 1.0f;
+		const float dh11 = 3.0f * s2 - 2.0f * s;
+
+		const Vector2 &p0 = positions_[knot];
+		const Vector2 &p1 = positions_[knot + 1];
+		const Vector2 m0 = duration * velocities_[knot];
+		const Vector2 m1 = duration * velocities_[knot + 1];
+
+		position = h00 * p0 + h10 * m0 + h01 * p1 + h11 * m1;
+		velocity = (dh00 * (p0 - p1) + dh10 * m0 + dh11 * m1) / duration;
+	}
+
+	Vector2 Trajectory::getPosition(float time) const
+	{
+		std::size_t knot = 0;
+		Vector2 position;
+		Vector2 velocity;
+		evaluate(time, knot, position, velocity);
+
+		return position;
+	}
+
+	Vector2 Trajectory::getVelocity(float time) const
+	{
+		std::size_t knot = 0;
+		Vector2 position;
+		Vector2 velocity;
+		evaluate(time, knot, position, velocity);
+
+		return velocity;
+	}
+
+	void Trajectory::setTrackingTime(float trackingTime)
+	{
+		if (!(trackingTime > 0.0f)) {
+			throw std::runtime_error("Tracking time not positive when setting tracking time.");
+		}
+
+		trackingTime_ = trackingTime;
+	}
+}
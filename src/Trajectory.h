@@ -0,0 +1,129 @@
+/*
+ * Trajectory.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   Trajectory.h
+ * \brief  Declares the Trajectory class.
+ */
+
+#ifndef HRVO_TRAJECTORY_H_
+#define HRVO_TRAJECTORY_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "Export.h"
+#include "Vector2.h"
+
+namespace hrvo {
+	/**
+	 * \class    Trajectory
+	 * \brief    A time-parameterized path to be tracked by agents; a piecewise cubic Hermite curve through knots with given positions and velocities at given global times.
+	 *
+	 * \details  Before its first knot, the trajectory holds the position of
+	 *           the first knot, and after its last knot, that of the last
+	 *           knot, both at rest.
+	 */
+	class HRVO_EXPORT Trajectory {
+	public:
+		/**
+		 * \brief  Constructor; the trajectory has no knots and a tracking time of 0.25.
+		 */
+		Trajectory();
+
+		/**
+		 * \brief      Adds a knot to the end of the trajectory.
+		 * \param[in]  time      The global time of the knot, which is later than that of the previous knot.
+		 * \param[in]  position  The position of the trajectory at the knot.
+		 * \param[in]  velocity  The velocity of the trajectory at the knot.
+		 */
+		void addKnot(float time, const Vector2 &position, const Vector2 &velocity);
+
+		/**
+		 * \brief   Returns the global time of the last knot of the trajectory.
+		 * \return  The end time of the trajectory, or zero if it has no knots.
+		 */
+		float getEndTime() const { return times_.empty() ? 0.0f : times_.back(); }
+
+		/**
+		 * \brief   Returns the count of knots of the trajectory.
+		 * \return  The count of knots of the trajectory.
+		 */
+		std::size_t getNumKnots() const { return times_.size(); }
+
+		/**
+		 * \brief   Returns the time over which an agent tracking the trajectory prefers to close the gap to its position.
+		 * \return  The tracking time of the trajectory.
+		 */
+		float getTrackingTime() const { return trackingTime_; }
+
+		/**
+		 * \brief      Returns the position of the trajectory at a global time.
+		 * \param[in]  time  The global time.
+		 * \return     The position of the trajectory.
+		 */
+		Vector2 getPosition(float time) const;
+
+		/**
+		 * \brief      Returns the velocity of the trajectory at a global time.
+		 * \param[in]  time  The global time.
+		 * \return     The velocity of the trajectory.
+		 */
+		Vector2 getVelocity(float time) const;
+
+		/**
+		 * \brief      Sets the time over which an agent tracking the trajectory prefers to close the gap to its position; shorter times track more tightly but correct more abruptly.
+		 * \param[in]  trackingTime  The tracking time, which is positive.
+		 */
+		void setTrackingTime(float trackingTime);
+
+	private:
+		/**
+		 * \brief          Computes the position and velocity of the trajectory at a global time.
+		 * \param[in]      time      The global time.
+		 * \param[in,out]  knot      The knot at which to start searching for the segment that contains the time, which is replaced by the knot that starts that segment; successive times of a simulation need only step the previous knot forwards.
+		 * \param[out]     position  The position of the trajectory.
+		 * \param[out]     velocity  The velocity of the trajectory.
+		 */
+		void evaluate(float time, std::size_t &knot, Vector2 &position, Vector2 &velocity) const;
+
+		std::vector<Vector2> positions_;
+		std::vector<Vector2> velocities_;
+		std::vector<float> times_;
+		float trackingTime_;
+
+		friend class Agent;
+		friend class Simulator;
+	};
+}
+
+#endif /* HRVO_TRAJECTORY_H_ */
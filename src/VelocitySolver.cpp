@@ -0,0 +1,440 @@
+/*
+ * VelocitySolver.cpp
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   VelocitySolver.cpp
+ * \brief  Defines the VelocitySolver class.
+ */
+
+#include "VelocitySolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Definitions.h"
+#include "FastMath.h"
+
+namespace hrvo {
+	/**
+	 * \brief  The maximum angle spanned by the velocity obstacle of a cluster of far neighbors.
+	 */
+	const float HRVO_CLUSTER_MAX_ANGLE = 0.25f * HRVO_PI;
+
+	/**
+	 * \brief  The maximum velocity difference, as a fraction of the maximum speed of the agent, between neighbors in the same cluster.
+	 */
+	const float HRVO_CLUSTER_VELOCITY_TOLERANCE = 0.1f;
+
+	void VelocitySolver::addCandidate(float distSq, const Candidate &candidate)
+	{
+		candidateOrder_.push_back(std::make_pair(distSq, candidates_.size()));
+		candidates_.push_back(candidate);
+	}
+
+	void VelocitySolver::addIntersection(const Query &query, float maxSpeedSq, int velocityObstacle1, const Vector2 &origin1, const Vector2 &direction1, float min1, float max1, int velocityObstacle2, const Vector2 &origin2, const Vector2 &direction2, float min2, float max2)
+	{
+		const float d = det(direction1, direction2);
+
+		if (d != 0.0f) {
+			const float s = det(origin2 - origin1, direction2) / d;
+			const float t = det(origin2 - origin1, direction1) / d;
+
+			if (s >= min1 && s <= max1 && t >= min2 && t <= max2) {
+				Candidate candidate;
+				candidate.position_ = origin1 + s * direction1;
+				candidate.velocityObstacle1_ = velocityObstacle1;
+				candidate.velocityObstacle2_ = velocityObstacle2;
+
+				if (absSq(candidate.position_) < maxSpeedSq) {
+					addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+				}
+			}
+		}
+	}
+
+	void VelocitySolver::computeClusterVelocityObstacles(float maxSpeed)
+	{
+		clusters_.clear();
+
+		for (std::size_t i = 0; i < farNeighbors_.size(); ++i) {
+			FarNeighbor &farNeighbor = farNeighbors_[i];
+			farNeighbor.cluster_ = clusters_.size();
+
+			for (std::size_t j = 0; j < clusters_.size(); ++j) {
+				Cluster &cluster = clusters_[j];
+
+				if (absSq(farNeighbor.velocity_ - cluster.velocity_) > sqr(HRVO_CLUSTER_VELOCITY_TOLERANCE * maxSpeed)) {
+					continue;
+				}
+
+				float offset = farNeighbor.angle_ - cluster.angle_;
+
+				if (offset > HRVO_PI) {
+					offset -= 2.0f * HRVO_PI;
+				}
+				else if (offset < -HRVO_PI) {
+					offset += 2.0f * HRVO_PI;
+				}
+
+				const float minOffset = std::min(cluster.minOffset_, offset - farNeighbor.openingAngle_);
+				const float maxOffset = std::max(cluster.maxOffset_, offset + farNeighbor.openingAngle_);
+
+				if (maxOffset - minOffset <= HRVO_CLUSTER_MAX_ANGLE) {
+					cluster.minOffset_ = minOffset;
+					cluster.maxOffset_ = maxOffset;
+					++cluster.size_;
+					farNeighbor.cluster_ = j;
+					break;
+				}
+			}
+
+			if (farNeighbor.cluster_ == clusters_.size()) {
+				Cluster cluster;
+				cluster.apex_ = farNeighbor.apex_;
+				cluster.velocity_ = farNeighbor.velocity_;
+				cluster.angle_ = farNeighbor.angle_;
+				cluster.minOffset_ = -farNeighbor.openingAngle_;
+				cluster.maxOffset_ = farNeighbor.openingAngle_;
+				clusters_.push_back(cluster);
+			}
+		}
+
+		for (std::size_t j = 0; j < clusters_.size(); ++j) {
+			Cluster &cluster = clusters_[j];
+			float sine;
+			float cosine;
+
+			fastSinCos(cluster.angle_ + cluster.minOffset_, sine, cosine);
+			cluster.side1_ = Vector2(cosine, sine);
+			fastSinCos(cluster.angle_ + cluster.maxOffset_, sine, cosine);
+			cluster.side2_ = Vector2(cosine, sine);
+			cluster.minDet1_ = det(cluster.side1_, cluster.apex_);
+			cluster.maxDet2_ = det(cluster.side2_, cluster.apex_);
+		}
+
+		for (std::size_t i = 0; i < farNeighbors_.size(); ++i) {
+			Cluster &cluster = clusters_[farNeighbors_[i].cluster_];
+			cluster.minDet1_ = std::min(cluster.minDet1_, det(cluster.side1_, farNeighbors_[i].apex_));
+			cluster.maxDet2_ = std::max(cluster.maxDet2_, det(cluster.side2_, farNeighbors_[i].apex_));
+		}
+
+		VelocityObstacle velocityObstacle;
+
+		for (std::size_t j = 0; j < clusters_.size(); ++j) {
+			const Cluster &cluster = clusters_[j];
+			velocityObstacle.side1_ = cluster.side1_;
+			velocityObstacle.side2_ = cluster.side2_;
+
+			if (cluster.size_ == 1) {
+				velocityObstacle.apex_ = cluster.apex_;
+			}
+			else {
+				// The apex lies on the first side through the member apex furthest to its right and on the second side through the member apex furthest to its left, so that the velocity obstacle contains those of all members.
+				const float d = det(cluster.side1_, cluster.side2_);
+				velocityObstacle.apex_ = Vector2(cluster.minDet1_ * cluster.side2_.getX() - cluster.maxDet2_ * cluster.side1_.getX(), cluster.minDet1_ * cluster.side2_.getY() - cluster.maxDet2_ * cluster.side1_.getY()) / d;
+			}
+
+			velocityObstacles_.push_back(velocityObstacle);
+		}
+	}
+
+	void VelocitySolver::setActiveVelocityObstacles(const Candidate &candidate)
+	{
+		activeVelocityObstacles_.clear();
+
+		if (candidate.velocityObstacle1_ != std::numeric_limits<int>::max()) {
+			activeVelocityObstacles_.push_back(static_cast<std::size_t>(candidate.velocityObstacle1_));
+		}
+
+		if (candidate.velocityObstacle2_ != std::numeric_limits<int>::max() && candidate.velocityObstacle2_ != candidate.velocityObstacle1_) {
+			activeVelocityObstacles_.push_back(static_cast<std::size_t>(candidate.velocityObstacle2_));
+		}
+	}
+
+	Vector2 VelocitySolver::solve(const Query &query, const Neighbor *neighbors, const float *distsSq, std::size_t numNeighbors)
+	{
+		// The maximum speed bounds every candidate, so its square is computed once per query.
+		const float maxSpeedSq = query.maxSpeed_ * query.maxSpeed_;
+
+		velocityObstacles_.clear();
+		velocityObstacles_.reserve(numNeighbors);
+		farNeighbors_.clear();
+
+		VelocityObstacle velocityObstacle;
+
+		for (std::size_t i = 0; i < numNeighbors; ++i) {
+			const Neighbor *const other = &neighbors[i];
+
+			if (absSq(other->position_ - query.position_) > sqr(other->radius_ + query.radius_)) {
+				const float angle = fastAtan(other->position_ - query.position_);
+				const float openingAngle = fastAsin((other->radius_ + query.radius_) / abs(other->position_ - query.position_));
+
+				float sine;
+				float cosine;
+
+				fastSinCos(angle - openingAngle, sine, cosine);
+				velocityObstacle.side1_ = Vector2(cosine, sine);
+				fastSinCos(angle + openingAngle, sine, cosine);
+				velocityObstacle.side2_ = Vector2(cosine, sine);
+				fastSinCos(openingAngle, sine, cosine);
+
+				const float d = 2.0f * sine * cosine;
+
+				if (det(other->position_ - query.position_, query.prefVelocity_ - other->prefVelocity_) > 0.0f) {
+					const float s = 0.5f * det(query.velocity_ - other->velocity_, velocityObstacle.side2_) / d;
+
+					velocityObstacle.apex_ = other->velocity_ + s * velocityObstacle.side1_ - (query.uncertaintyOffset_ * abs(other->position_ - query.position_) / (other->radius_ + query.radius_)) * fastNormalize(other->position_ - query.position_);
+				}
+				else {
+					const float s = 0.5f * det(query.velocity_ - other->velocity_, velocityObstacle.side1_) / d;
+
+					velocityObstacle.apex_ = other->velocity_ + s * velocityObstacle.side2_ - (query.uncertaintyOffset_ * abs(other->position_ - query.position_) / (other->radius_ + query.radius_)) * fastNormalize(other->position_ - query.position_);
+				}
+
+				// Velocities that collide within the time horizon lie at least (distance - combined radius) / timeHorizon from the apex; drop the velocity obstacle if no velocity within the maximum speed gets that far.
+				if (abs(other->position_ - query.position_) - (other->radius_ + query.radius_) > query.timeHorizon_ * (query.maxSpeed_ + abs(velocityObstacle.apex_))) {
+					continue;
+				}
+
+				// Otherwise cut it off at the segment between its sides tangent to the velocities that collide at the time horizon, which keeps it conservative.
+				velocityObstacle.cutoff_ = (abs(other->position_ - query.position_) - (other->radius_ + query.radius_)) / (query.timeHorizon_ * cosine);
+
+				if ((distsSq != NULL ? distsSq[i] : absSq(other->position_ - query.position_)) > query.clusterDist_ * query.clusterDist_) {
+					FarNeighbor farNeighbor;
+					farNeighbor.apex_ = velocityObstacle.apex_;
+					farNeighbor.velocity_ = other->velocity_;
+					farNeighbor.angle_ = angle;
+					farNeighbor.openingAngle_ = openingAngle;
+					farNeighbors_.push_back(farNeighbor);
+				}
+				else {
+					velocityObstacles_.push_back(velocityObstacle);
+				}
+			}
+			else {
+				velocityObstacle.apex_ = 0.5f * (other->velocity_ + query.velocity_) - (query.uncertaintyOffset_ + 0.5f * (other->radius_ + query.radius_ - abs(other->position_ - query.position_)) / query.timeStep_) * fastNormalize(other->position_ - query.position_);
+				velocityObstacle.side1_ = normal(query.position_, other->position_);
+				velocityObstacle.side2_ = -velocityObstacle.side1_;
+				velocityObstacle.cutoff_ = 0.0f;
+				velocityObstacles_.push_back(velocityObstacle);
+			}
+		}
+
+		if (!farNeighbors_.empty()) {
+			computeClusterVelocityObstacles(query.maxSpeed_);
+		}
+
+		candidates_.clear();
+		candidateOrder_.clear();
+
+		Candidate candidate;
+
+		candidate.velocityObstacle1_ = std::numeric_limits<int>::max();
+		candidate.velocityObstacle2_ = std::numeric_limits<int>::max();
+
+		if (absSq(query.prefVelocity_) < maxSpeedSq) {
+			candidate.position_ = query.prefVelocity_;
+		}
+		else {
+			candidate.position_ = query.maxSpeed_ * fastNormalize(query.prefVelocity_);
+		}
+
+		addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+
+		for (int i = 0; i < static_cast<int>(velocityObstacles_.size()); ++i) {
+			candidate.velocityObstacle1_ = i;
+			candidate.velocityObstacle2_ = i;
+
+			const float dotProduct1 = (query.prefVelocity_ - velocityObstacles_[i].apex_) * velocityObstacles_[i].side1_;
+			const float dotProduct2 = (query.prefVelocity_ - velocityObstacles_[i].apex_) * velocityObstacles_[i].side2_;
+
+			if (dotProduct1 > velocityObstacles_[i].cutoff_ && det(velocityObstacles_[i].side1_, query.prefVelocity_ - velocityObstacles_[i].apex_) > 0.0f) {
+				candidate.position_ = velocityObstacles_[i].apex_ + dotProduct1 * velocityObstacles_[i].side1_;
+
+				if (absSq(candidate.position_) < maxSpeedSq) {
+					addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+				}
+			}
+
+			if (dotProduct2 > velocityObstacles_[i].cutoff_ && det(velocityObstacles_[i].side2_, query.prefVelocity_ - velocityObstacles_[i].apex_) < 0.0f) {
+				candidate.position_ = velocityObstacles_[i].apex_ + dotProduct2 * velocityObstacles_[i].side2_;
+
+				if (absSq(candidate.position_) < maxSpeedSq) {
+					addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+				}
+			}
+
+			if (velocityObstacles_[i].cutoff_ > 0.0f) {
+				const Vector2 corner = velocityObstacles_[i].apex_ + velocityObstacles_[i].cutoff_ * velocityObstacles_[i].side1_;
+				const Vector2 cutoff = velocityObstacles_[i].cutoff_ * (velocityObstacles_[i].side2_ - velocityObstacles_[i].side1_);
+				const float s = (query.prefVelocity_ - corner) * cutoff / absSq(cutoff);
+
+				if (s > 0.0f && s < 1.0f && det(cutoff, query.prefVelocity_ - corner) < 0.0f) {
+					candidate.position_ = corner + s * cutoff;
+
+					if (absSq(candidate.position_) < maxSpeedSq) {
+						addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+					}
+				}
+			}
+		}
+
+		for (int j = 0; j < static_cast<int>(velocityObstacles_.size()); ++j) {
+			candidate.velocityObstacle1_ = std::numeric_limits<int>::max();
+			candidate.velocityObstacle2_ = j;
+
+			float discriminant = maxSpeedSq - sqr(det(velocityObstacles_[j].apex_, velocityObstacles_[j].side1_));
+
+			if (discriminant > 0.0f) {
+
+				const float t1 = -(velocityObstacles_[j].apex_ * velocityObstacles_[j].side1_) + std::sqrt(discriminant);
+				const float t2 = -(velocityObstacles_[j].apex_ * velocityObstacles_[j].side1_) - std::sqrt(discriminant);
+
+				if (t1 >= velocityObstacles_[j].cutoff_) {
+					candidate.position_ = velocityObstacles_[j].apex_ + t1 * velocityObstacles_[j].side1_;
+					addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+				}
+
+				if (t2 >= velocityObstacles_[j].cutoff_) {
+					candidate.position_ = velocityObstacles_[j].apex_ + t2 * velocityObstacles_[j].side1_;
+					addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+				}
+			}
+
+			discriminant = maxSpeedSq - sqr(det(velocityObstacles_[j].apex_, velocityObstacles_[j].side2_));
+
+			if (discriminant > 0.0f) {
+				const float t1 = -(velocityObstacles_[j].apex_ * velocityObstacles_[j].side2_) + std::sqrt(discriminant);
+				const float t2 = -(velocityObstacles_[j].apex_ * velocityObstacles_[j].side2_) - std::sqrt(discriminant);
+
+				if (t1 >= velocityObstacles_[j].cutoff_) {
+					candidate.position_ = velocityObstacles_[j].apex_ + t1 * velocityObstacles_[j].side2_;
+					addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+				}
+
+				if (t2 >= velocityObstacles_[j].cutoff_) {
+					candidate.position_ = velocityObstacles_[j].apex_ + t2 * velocityObstacles_[j].side2_;
+					addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+				}
+			}
+
+			if (velocityObstacles_[j].cutoff_ > 0.0f) {
+				const Vector2 corner = velocityObstacles_[j].apex_ + velocityObstacles_[j].cutoff_ * velocityObstacles_[j].side1_;
+				const Vector2 cutoff = velocityObstacles_[j].cutoff_ * (velocityObstacles_[j].side2_ - velocityObstacles_[j].side1_);
+
+				discriminant = sqr(corner * cutoff) - absSq(cutoff) * (absSq(corner) - maxSpeedSq);
+
+				if (discriminant > 0.0f) {
+					const float s1 = (-(corner * cutoff) + std::sqrt(discriminant)) / absSq(cutoff);
+					const float s2 = (-(corner * cutoff) - std::sqrt(discriminant)) / absSq(cutoff);
+
+					if (s1 >= 0.0f && s1 <= 1.0f) {
+						candidate.position_ = corner + s1 * cutoff;
+						addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+					}
+
+					if (s2 >= 0.0f && s2 <= 1.0f) {
+						candidate.position_ = corner + s2 * cutoff;
+						addCandidate(absSq(query.prefVelocity_ - candidate.position_), candidate);
+					}
+				}
+			}
+		}
+
+		// The sides of a truncated velocity obstacle begin at its cutoff segment, which runs from the first side to the second.
+		for (int i = 0; i < static_cast<int>(velocityObstacles_.size()) - 1; ++i) {
+			const VelocityObstacle &velocityObstacle1 = velocityObstacles_[i];
+			const Vector2 corner1 = velocityObstacle1.apex_ + velocityObstacle1.cutoff_ * velocityObstacle1.side1_;
+			const Vector2 cutoff1 = velocityObstacle1.cutoff_ * (velocityObstacle1.side2_ - velocityObstacle1.side1_);
+
+			for (int j = i + 1; j < static_cast<int>(velocityObstacles_.size()); ++j) {
+				const VelocityObstacle &velocityObstacle2 = velocityObstacles_[j];
+
+				addIntersection(query, maxSpeedSq, i, velocityObstacle1.apex_, velocityObstacle1.side1_, velocityObstacle1.cutoff_, std::numeric_limits<float>::infinity(), j, velocityObstacle2.apex_, velocityObstacle2.side1_, velocityObstacle2.cutoff_, std::numeric_limits<float>::infinity());
+				addIntersection(query, maxSpeedSq, i, velocityObstacle1.apex_, velocityObstacle1.side2_, velocityObstacle1.cutoff_, std::numeric_limits<float>::infinity(), j, velocityObstacle2.apex_, velocityObstacle2.side1_, velocityObstacle2.cutoff_, std::numeric_limits<float>::infinity());
+				addIntersection(query, maxSpeedSq, i, velocityObstacle1.apex_, velocityObstacle1.side1_, velocityObstacle1.cutoff_, std::numeric_limits<float>::infinity(), j, velocityObstacle2.apex_, velocityObstacle2.side2_, velocityObstacle2.cutoff_, std::numeric_limits<float>::infinity());
+				addIntersection(query, maxSpeedSq, i, velocityObstacle1.apex_, velocityObstacle1.side2_, velocityObstacle1.cutoff_, std::numeric_limits<float>::infinity(), j, velocityObstacle2.apex_, velocityObstacle2.side2_, velocityObstacle2.cutoff_, std::numeric_limits<float>::infinity());
+
+				if (velocityObstacle1.cutoff_ > 0.0f) {
+					addIntersection(query, maxSpeedSq, i, corner1, cutoff1, 0.0f, 1.0f, j, velocityObstacle2.apex_, velocityObstacle2.side1_, velocityObstacle2.cutoff_, std::numeric_limits<float>::infinity());
+					addIntersection(query, maxSpeedSq, i, corner1, cutoff1, 0.0f, 1.0f, j, velocityObstacle2.apex_, velocityObstacle2.side2_, velocityObstacle2.cutoff_, std::numeric_limits<float>::infinity());
+				}
+
+				if (velocityObstacle2.cutoff_ > 0.0f) {
+					const Vector2 corner2 = velocityObstacle2.apex_ + velocityObstacle2.cutoff_ * velocityObstacle2.side1_;
+					const Vector2 cutoff2 = velocityObstacle2.cutoff_ * (velocityObstacle2.side2_ - velocityObstacle2.side1_);
+
+					addIntersection(query, maxSpeedSq, i, velocityObstacle1.apex_, velocityObstacle1.side1_, velocityObstacle1.cutoff_, std::numeric_limits<float>::infinity(), j, corner2, cutoff2, 0.0f, 1.0f);
+					addIntersection(query, maxSpeedSq, i, velocityObstacle1.apex_, velocityObstacle1.side2_, velocityObstacle1.cutoff_, std::numeric_limits<float>::infinity(), j, corner2, cutoff2, 0.0f, 1.0f);
+
+					if (velocityObstacle1.cutoff_ > 0.0f) {
+						addIntersection(query, maxSpeedSq, i, corner1, cutoff1, 0.0f, 1.0f, j, corner2, cutoff2, 0.0f, 1.0f);
+					}
+				}
+			}
+		}
+
+		// Candidates equally close to the preferred velocity are tested in the order in which they were added.
+		std::sort(candidateOrder_.begin(), candidateOrder_.end());
+
+		Vector2 velocity;
+		int optimal = -1;
+		activeVelocityObstacles_.clear();
+
+		for (std::vector<std::pair<float, std::size_t> >::const_iterator iter = candidateOrder_.begin(); iter != candidateOrder_.end(); ++iter) {
+			candidate = candidates_[iter->second];
+			bool valid = true;
+
+			for (int j = 0; j < static_cast<int>(velocityObstacles_.size()); ++j) {
+				if (j != candidate.velocityObstacle1_ && j != candidate.velocityObstacle2_ && det(velocityObstacles_[j].side2_, candidate.position_ - velocityObstacles_[j].apex_) < 0.0f && det(velocityObstacles_[j].side1_, candidate.position_ - velocityObstacles_[j].apex_) > 0.0f && (velocityObstacles_[j].cutoff_ == 0.0f || det(velocityObstacles_[j].side2_ - velocityObstacles_[j].side1_, candidate.position_ - velocityObstacles_[j].apex_ - velocityObstacles_[j].cutoff_ * velocityObstacles_[j].side1_) < 0.0f)) {
+					valid = false;
+
+					if (j > optimal) {
+						optimal = j;
+						velocity = candidate.position_;
+						setActiveVelocityObstacles(candidate);
+					}
+
+					break;
+				}
+			}
+
+			if (valid) {
+				velocity = candidate.position_;
+				setActiveVelocityObstacles(candidate);
+				break;
+			}
+		}
+
+		return velocity;
+	}
+}
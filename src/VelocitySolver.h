@@ -0,0 +1,395 @@
+/*
+ * VelocitySolver.h
+ * HRVO Library
+ *
+ * Copyright 2009 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jamie Snape, Jur van den Berg, Stephen J. Guy, and Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <https://gamma.cs.unc.edu/HRVO/>
+ */
+
+/**
+ * \file   VelocitySolver.h
+ * \brief  Declares the VelocitySolver class.
+ */
+
+#ifndef HRVO_VELOCITY_SOLVER_H_
+#define HRVO_VELOCITY_SOLVER_H_
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "Export.h"
+#include "Vector2.h"
+
+namespace hrvo {
+	class Agent;
+
+	/**
+	 * \class    VelocitySolver
+	 * \brief    Chooses the velocity of an agent among its neighbors from their hybrid reciprocal velocity obstacles, without a simulation.
+	 *
+	 * \details  A solver holds only the scratch memory of the last query,
+	 *           which it reuses, so queries allocate no memory once it has
+	 *           grown. Queries on different solvers may run on any number of
+	 *           threads at once.
+	 */
+	class HRVO_EXPORT VelocitySolver {
+	public:
+		/**
+		 * \class  Query
+		 * \brief  The agent whose velocity is chosen.
+		 */
+		class Query {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			Query() : clusterDist_(std::numeric_limits<float>::infinity()), maxSpeed_(0.0f), radius_(0.0f), timeHorizon_(std::numeric_limits<float>::infinity()), timeStep_(0.0f), uncertaintyOffset_(0.0f) { }
+
+			/**
+			 * \brief  The position of the agent.
+			 */
+			Vector2 position_;
+
+			/**
+			 * \brief  The preferred velocity of the agent.
+			 */
+			Vector2 prefVelocity_;
+
+			/**
+			 * \brief  The velocity of the agent.
+			 */
+			Vector2 velocity_;
+
+			/**
+			 * \brief  The distance between centers beyond which neighbors with similar directions and velocities share a velocity obstacle.
+			 */
+			float clusterDist_;
+
+			/**
+			 * \brief  The maximum speed of the agent.
+			 */
+			float maxSpeed_;
+
+			/**
+			 * \brief  The radius of the agent.
+			 */
+			float radius_;
+
+			/**
+			 * \brief  The time horizon beyond which collisions are ignored, which truncates the velocity obstacles.
+			 */
+			float timeHorizon_;
+
+			/**
+			 * \brief  The time step over which the agent separates from any neighbor it overlaps; must be positive.
+			 */
+			float timeStep_;
+
+			/**
+			 * \brief  The uncertainty offset of the agent.
+			 */
+			float uncertaintyOffset_;
+		};
+
+		/**
+		 * \class  Neighbor
+		 * \brief  The state of a neighbor of the agent whose velocity is chosen.
+		 */
+		class Neighbor {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			Neighbor() : radius_(0.0f) { }
+
+			/**
+			 * \brief  The position of the neighbor.
+			 */
+			Vector2 position_;
+
+			/**
+			 * \brief  The preferred velocity of the neighbor.
+			 */
+			Vector2 prefVelocity_;
+
+			/**
+			 * \brief  The velocity of the neighbor.
+			 */
+			Vector2 velocity_;
+
+			/**
+			 * \brief  The radius of the neighbor.
+			 */
+			float radius_;
+		};
+
+		/**
+		 * \class  VelocityObstacle
+		 * \brief  A hybrid reciprocal velocity obstacle; the velocities between its sides and beyond its cutoff are excluded.
+		 */
+		class VelocityObstacle {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			VelocityObstacle() : cutoff_(0.0f) { }
+
+			/**
+			 * \brief  The position of the apex of the hybrid reciprocal velocity obstacle.
+			 */
+			Vector2 apex_;
+
+
+			/**
+			 * \brief  The direction of the first side of the hybrid reciprocal velocity obstacle.
+			 */
+			Vector2 side1_;
+
+			/**
+			 * \brief  The direction of the second side of the hybrid reciprocal velocity obstacle.
+			 */
+			Vector2 side2_;
+
+			/**
+			 * \brief  The distance along each side from the apex to the cutoff segment of the hybrid reciprocal velocity obstacle, which joins the sides where velocities start to collide within the time horizon, or zero if it is not truncated.
+			 */
+			float cutoff_;
+		};
+
+		/**
+		 * \brief  Constructor.
+		 */
+		VelocitySolver() { }
+
+		/**
+		 * \brief      Chooses the velocity of an agent among its neighbors.
+		 * \param[in]  query         The agent whose velocity is chosen.
+		 * \param[in]  neighbors     The neighbors of the agent.
+		 * \param[in]  numNeighbors  The count of neighbors of the agent.
+		 * \return     The velocity closest to the preferred velocity within the maximum speed and outside all velocity obstacles, or that outside the most velocity obstacles if none is.
+		 */
+		Vector2 computeVelocity(const Query &query, const Neighbor *neighbors, std::size_t numNeighbors) { return solve(query, neighbors, NULL, numNeighbors); }
+
+		/**
+		 * \brief   Returns the numbers of the velocity obstacles on whose sides the velocity chosen by the last query lies.
+		 * \return  The numbers of at most two active velocity obstacles, in the order returned by getVelocityObstacles().
+		 */
+		const std::vector<std::size_t> &getActiveVelocityObstacles() const { return activeVelocityObstacles_; }
+
+		/**
+		 * \brief   Returns the velocity obstacles of the last query, after neighbors beyond the cluster distance have been merged.
+		 * \return  The velocity obstacles of the last query.
+		 */
+		const std::vector<VelocityObstacle> &getVelocityObstacles() const { return velocityObstacles_; }
+
+	private:
+		/**
+		 * \class  Candidate
+		 * \brief  A candidate point.
+		 */
+		class Candidate {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			Candidate() : velocityObstacle1_(0), velocityObstacle2_(0) { }
+
+			/**
+			 * \brief  The position of the candidate point.
+			 */
+			Vector2 position_;
+
+			/**
+			 * \brief  The number of the first velocity obstacle.
+			 */
+			int velocityObstacle1_;
+
+			/**
+			 * \brief  The number of the second velocity obstacle.
+			 */
+			int velocityObstacle2_;
+		};
+
+		/**
+		 * \class  FarNeighbor
+		 * \brief  The velocity obstacle of a neighbor beyond the cluster distance, before it is merged into a cluster.
+		 */
+		class FarNeighbor {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			FarNeighbor() : cluster_(0), angle_(0.0f), openingAngle_(0.0f) { }
+
+			/**
+			 * \brief  The position of the apex of the velocity obstacle.
+			 */
+			Vector2 apex_;
+
+			/**
+			 * \brief  The velocity of the neighbor.
+			 */
+			Vector2 velocity_;
+
+			/**
+			 * \brief  The number of the cluster of the neighbor.
+			 */
+			std::size_t cluster_;
+
+			/**
+			 * \brief  The angle of the relative position of the neighbor.
+			 */
+			float angle_;
+
+			/**
+			 * \brief  The half-angle of the velocity obstacle.
+			 */
+			float openingAngle_;
+		};
+
+		/**
+		 * \class  Cluster
+		 * \brief  A cluster of far neighbors with similar directions and velocities that share a single velocity obstacle.
+		 */
+		class Cluster {
+		public:
+			/**
+			 * \brief  Constructor.
+			 */
+			Cluster() : size_(1), angle_(0.0f), maxDet2_(0.0f), maxOffset_(0.0f), minDet1_(0.0f), minOffset_(0.0f) { }
+
+			/**
+			 * \brief  The position of the apex of the velocity obstacle of the first neighbor in the cluster.
+			 */
+			Vector2 apex_;
+
+			/**
+			 * \brief  The direction of the first side of the velocity obstacle of the cluster.
+			 */
+			Vector2 side1_;
+
+			/**
+			 * \brief  The direction of the second side of the velocity obstacle of the cluster.
+			 */
+			Vector2 side2_;
+
+			/**
+			 * \brief  The velocity of the first neighbor in the cluster.
+			 */
+			Vector2 velocity_;
+
+			/**
+			 * \brief  The number of neighbors in the cluster.
+			 */
+			std::size_t size_;
+
+			/**
+			 * \brief  The angle of the relative position of the first neighbor in the cluster.
+			 */
+			float angle_;
+
+			/**
+			 * \brief  The maximum determinant of the second side with the apex of any velocity obstacle in the cluster.
+			 */
+			float maxDet2_;
+
+			/**
+			 * \brief  The angle of the second side relative to the angle of the cluster.
+			 */
+			float maxOffset_;
+
+			/**
+			 * \brief  The minimum determinant of the first side with the apex of any velocity obstacle in the cluster.
+			 */
+			float minDet1_;
+
+			/**
+			 * \brief  The angle of the first side relative to the angle of the cluster.
+			 */
+			float minOffset_;
+		};
+
+		/**
+		 * \brief      Adds a candidate point, ordered by its squared distance to the preferred velocity.
+		 * \param[in]  distSq     The squared distance from the candidate point to the preferred velocity.
+		 * \param[in]  candidate  The candidate point.
+		 */
+		void addCandidate(float distSq, const Candidate &candidate);
+
+		/**
+		 * \brief      Adds the intersection of two edges of velocity obstacles as a candidate point if it lies on both edges and within the maximum speed.
+		 * \param[in]  query              The agent whose velocity is chosen.
+		 * \param[in]  maxSpeedSq         The square of the maximum speed of the agent.
+		 * \param[in]  velocityObstacle1  The number of the velocity obstacle of the first edge.
+		 * \param[in]  origin1            The origin of the first edge.
+		 * \param[in]  direction1         The direction of the first edge.
+		 * \param[in]  min1               The minimum parameter of the first edge.
+		 * \param[in]  max1               The maximum parameter of the first edge.
+		 * \param[in]  velocityObstacle2  The number of the velocity obstacle of the second edge.
+		 * \param[in]  origin2            The origin of the second edge.
+		 * \param[in]  direction2         The direction of the second edge.
+		 * \param[in]  min2               The minimum parameter of the second edge.
+		 * \param[in]  max2               The maximum parameter of the second edge.
+		 */
+		void addIntersection(const Query &query, float maxSpeedSq, int velocityObstacle1, const Vector2 &origin1, const Vector2 &direction1, float min1, float max1, int velocityObstacle2, const Vector2 &origin2, const Vector2 &direction2, float min2, float max2);
+
+		/**
+		 * \brief      Merges the velocity obstacles of the far neighbors into one conservative velocity obstacle per cluster.
+		 * \param[in]  maxSpeed  The maximum speed of the agent.
+		 */
+		void computeClusterVelocityObstacles(float maxSpeed);
+
+		/**
+		 * \brief      Sets the active velocity obstacles to those on whose sides a candidate point lies.
+		 * \param[in]  candidate  The candidate point.
+		 */
+		void setActiveVelocityObstacles(const Candidate &candidate);
+
+		/**
+		 * \brief      Chooses the velocity of an agent among its neighbors.
+		 * \param[in]  query         The agent whose velocity is chosen.
+		 * \param[in]  neighbors     The neighbors of the agent.
+		 * \param[in]  distsSq       The squared distances from the agent to its neighbors, compared with the square of the cluster distance, or NULL for the squared distances between their centers.
+		 * \param[in]  numNeighbors  The count of neighbors of the agent.
+		 * \return     The chosen velocity.
+		 */
+		Vector2 solve(const Query &query, const Neighbor *neighbors, const float *distsSq, std::size_t numNeighbors);
+
+		std::vector<std::size_t> activeVelocityObstacles_;
+		std::vector<Candidate> candidates_;
+		std::vector<std::pair<float, std::size_t> > candidateOrder_;
+		std::vector<Cluster> clusters_;
+		std::vector<FarNeighbor> farNeighbors_;
+		std::vector<VelocityObstacle> velocityObstacles_;
+
+		friend class Agent;
+	};
+}
+
+#endif /* HRVO_VELOCITY_SOLVER_H_ */
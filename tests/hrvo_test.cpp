@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <HRVO.h>
 #include <fstream>
+#include "FastMath.h"
 
 using namespace hrvo;
 
@@ -159,6 +160,18 @@ TEST_F(HRVOTest, div_b_edge_test) {
     create_div_b_field();
 }
 
+TEST_F(HRVOTest, div_b_edge_test_with_surface_distance) {
+    /** Same as div_b_edge_test, but the large obstacle is found with a short surface neighbor distance **/
+    simulator.setNeighborSurfaceDistance(true);
+    simulator.setAgentDefaults(1.f, 10, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.5f, /*maxSpeed=*/4.825f, /*uncertaintyOffset=*/0.f, /*maxAccel=*/3.28f);
+
+    const Vector2 goal_offset = Vector2(8.f, 0);
+    const Vector2 position = -1*(goal_offset / 2) + Vector2(0.f, 2.5f);
+    simulator.addAgent(position, simulator.addGoal(position + goal_offset));
+    add_static_obstacle(Vector2(0, 2.f), 0.75f);
+    create_div_b_field();
+}
+
 TEST_F(HRVOTest, 25_robots_around_circle) {
    // TODO: Can use Agent.SetAgentRadius to set custom radius for robots.
    //       Could have a randomly assigned radius with in a range
@@ -174,6 +187,83 @@ TEST_F(HRVOTest, 25_robots_around_circle) {
 	}
 }
 
+TEST_F(HRVOTest, 25_robots_around_circle_with_time_horizon) {
+   /** Same as 25_robots_around_circle, but velocity obstacles are truncated at 0.5 s **/
+   simulator.setAgentDefaults(3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.5f, /*maxSpeed=*/4.825f, /*uncertaintyOffset=*/0.f, /*maxAccel=*/3.28f, Vector2(), 0.f, /*timeHorizon=*/0.5f);
+
+   const int num_robots = 25;
+   float robot_starting_angle_dif = HRVO_TWO_PI / num_robots;
+   float circle_radius = std::max(float(num_robots) / 10, 2.f);
+   simulator.addAgent(Vector2(0.f, 0.f), simulator.addGoal(Vector2(0.f, 0.f)));
+   for (std::size_t i = 0; i < num_robots; ++i) {
+		const Vector2 position = circle_radius * Vector2(std::cos(i * robot_starting_angle_dif), std::sin(i * robot_starting_angle_dif));
+		simulator.addAgent(position, simulator.addGoal(-position));
+	}
+}
+
+TEST_F(HRVOTest, 25_robots_around_circle_with_decision_intervals) {
+   /** Same as 25_robots_around_circle, but robots decide again after half their time to collision, between one step and 0.25 s **/
+   simulator.setDecisionIntervals(1.f/30, 0.25f);
+
+   const int num_robots = 25;
+   float robot_starting_angle_dif = HRVO_TWO_PI / num_robots;
+   float circle_radius = std::max(float(num_robots) / 10, 2.f);
+   simulator.addAgent(Vector2(0.f, 0.f), simulator.addGoal(Vector2(0.f, 0.f)));
+   for (std::size_t i = 0; i < num_robots; ++i) {
+		const Vector2 position = circle_radius * Vector2(std::cos(i * robot_starting_angle_dif), std::sin(i * robot_starting_angle_dif));
+		simulator.addAgent(position, simulator.addGoal(-position));
+	}
+}
+
+TEST_F(HRVOTest, 25_robots_around_circle_with_adaptive_time_step) {
+   /** Same as 25_robots_around_circle, but steps are divided so that robots are not predicted to overlap by more than 1 cm **/
+   simulator.setAdaptiveTimeStep(0.01f, 1.f/240);
+
+   const int num_robots = 25;
+   float robot_starting_angle_dif = HRVO_TWO_PI / num_robots;
+   float circle_radius = std::max(float(num_robots) / 10, 2.f);
+   simulator.addAgent(Vector2(0.f, 0.f), simulator.addGoal(Vector2(0.f, 0.f)));
+   for (std::size_t i = 0; i < num_robots; ++i) {
+		const Vector2 position = circle_radius * Vector2(std::cos(i * robot_starting_angle_dif), std::sin(i * robot_starting_angle_dif));
+		simulator.addAgent(position, simulator.addGoal(-position));
+	}
+}
+
+TEST_F(HRVOTest, robot_decides_again_after_its_goal_or_decision_intervals_change) {
+    /** A lone robot has no collision to bound its decision interval, so it would keep its new velocity for 1 s **/
+    simulator.setDecisionIntervals(0.5f, 1.f);
+    simulator.addAgent(Vector2(0.f, 0.f), simulator.addGoal(Vector2(4.f, 0.f)));
+    simulator.doStep();
+    EXPECT_GT(simulator.getAgentNewVelocity(0).getX(), 0.f);
+
+    simulator.setAgentGoal(0, simulator.addGoal(Vector2(-4.f, 0.f)));
+    simulator.doStep();
+    EXPECT_LT(simulator.getAgentNewVelocity(0).getX(), 0.f);
+
+    /** Passing the first waypoint does not reset the decision interval, but dropping the intervals does **/
+    simulator.setAgentGoal(0, simulator.addGoalPositions({simulator.getAgentPosition(0) + Vector2(0.f, 0.1f), Vector2(0.f, 4.f)}));
+    simulator.doStep();
+    simulator.doStep();
+    simulator.doStep();
+    const float committed_y = simulator.getAgentNewVelocity(0).getY();
+    simulator.setDecisionIntervals(0.f, 0.f);
+    simulator.doStep();
+    EXPECT_NE(committed_y, simulator.getAgentNewVelocity(0).getY());
+}
+
+TEST_F(HRVOTest, overlapping_robots_separate_within_sub_step) {
+    /** An overlapping pair at rest, and a robot that does not see the parked robot it runs into, which shortens the sub-steps **/
+    simulator.setAdaptiveTimeStep(0.01f, 0.001f);
+    simulator.addAgent(Vector2(0.f, 0.f), simulator.addGoal(Vector2(0.f, 0.f)), 1.f, 10, ROBOT_RADIUS, ROBOT_RADIUS, 0.1f, 1.f);
+    simulator.addAgent(Vector2(0.15f, 0.f), simulator.addGoal(Vector2(0.15f, 0.f)), 1.f, 10, ROBOT_RADIUS, ROBOT_RADIUS, 0.1f, 1.f);
+    simulator.addAgent(Vector2(5.f, 0.f), simulator.addGoal(Vector2(5.f, 0.f)), 1.f, 10, ROBOT_RADIUS, ROBOT_RADIUS, 0.1f, 0.01f);
+    simulator.addAgent(Vector2(5.25f, 0.f), simulator.addGoal(Vector2(-5.f, 0.f)), 0.01f, 1, ROBOT_RADIUS, ROBOT_RADIUS, 3.5f, 4.825f);
+    simulator.doStep();
+
+    /** The pair separates within the first sub-step rather than over the whole step **/
+    EXPECT_GE(abs(simulator.getAgentPosition(1) - simulator.getAgentPosition(0)), 2.f * ROBOT_RADIUS);
+}
+
 TEST_F(HRVOTest, 5_robots_in_vertical_line) {
    const int num_robots = 5;
    /** Add robots in a vertical line where they all have to move down **/
@@ -193,4 +283,939 @@ TEST_F(HRVOTest, 1_robot_multiple_goals) {
     simulator.addAgent(Vector2(-4.f, -4.f), simulator.addGoalPositions({Vector2(4.f, -4.f), Vector2(4.f, 4.f), Vector2(-4.f, 4.f), Vector2(-4.f, -4.f)}));
 }
 
-// TODO: Test with changing goal position
\ No newline at end of file
+enum StepMode { SYNC_STEPS, ASYNC_STEPS, STAGED_STEPS };
+
+unsigned long long trajectory_hash(std::size_t num_threads, StepMode step_mode = SYNC_STEPS)
+{
+    Simulator simulator;
+    simulator.setTimeStep(1.f/30);
+    simulator.setNumThreads(num_threads);
+    simulator.setAgentDefaults(1.f, 10, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.5f, /*maxSpeed=*/4.825f, /*uncertaintyOffset=*/0.f, /*maxAccel=*/3.28f);
+
+    /** A grid of robots crossing to the opposite side, with some sharing a goal **/
+    const std::size_t shared_goal = simulator.addGoal(Vector2(0.f, 0.f));
+    for (std::size_t i = 0; i < 400; ++i) {
+        const Vector2 position(static_cast<float>(i % 20) * 0.5f - 5.f, static_cast<float>(i / 20) * 0.5f - 5.f);
+        simulator.addAgent(position, i % 7 == 0 ? shared_goal : simulator.addGoal(-position));
+    }
+
+    const float time_step = simulator.getTimeStep();
+    std::vector<Vector2> published_positions(simulator.getNumAgents());
+    for (int frame = 0; frame < 60; ++frame) {
+        if (step_mode == ASYNC_STEPS) {
+            const float step_start = simulator.getGlobalTime();
+            std::future<void> step = simulator.doStepAsync();
+
+            /** Work on the caller thread overlapped with the step, reading only the published state **/
+            simulator.getAgentPositions(0, published_positions.size(), published_positions.data());
+            float spread = 0.f;
+            for (std::size_t robot_id = 0; robot_id < published_positions.size(); ++robot_id) {
+                spread = std::max(spread, abs(published_positions[robot_id]));
+            }
+            EXPECT_GT(spread, 0.f);
+            const float published_time = simulator.getGlobalTime();
+            EXPECT_TRUE(published_time == step_start || published_time == step_start + time_step);
+
+            step.get();
+            EXPECT_EQ(step_start + time_step, simulator.getGlobalTime());
+        }
+        else if (step_mode == STAGED_STEPS) {
+            simulator.buildIndex();
+            simulator.computeVelocities();
+            simulator.integrate(simulator.getTimeStep());
+        }
+        else {
+            simulator.doStep();
+        }
+    }
+
+    // FNV-1a over the bits of every position
+    unsigned long long hash = 14695981039346656037ULL;
+    for (std::size_t robot_id = 0; robot_id < simulator.getNumAgents(); ++robot_id) {
+        const float coordinates[2] = {simulator.getAgentPosition(robot_id).getX(), simulator.getAgentPosition(robot_id).getY()};
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(coordinates);
+        for (std::size_t i = 0; i < sizeof(coordinates); ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+TEST_F(HRVOTest, trajectories_independent_of_thread_count) {
+    const unsigned long long serial_hash = trajectory_hash(1);
+    EXPECT_EQ(serial_hash, trajectory_hash(4));
+    EXPECT_EQ(serial_hash, trajectory_hash(0));
+}
+
+TEST_F(HRVOTest, async_steps_match_sync_steps) {
+    EXPECT_EQ(trajectory_hash(1), trajectory_hash(1, ASYNC_STEPS));
+    EXPECT_EQ(trajectory_hash(4), trajectory_hash(4, ASYNC_STEPS));
+}
+
+TEST_F(HRVOTest, staged_steps_match_sync_steps) {
+    EXPECT_EQ(trajectory_hash(1), trajectory_hash(1, STAGED_STEPS));
+}
+
+TEST_F(HRVOTest, staged_steps_reject_stale_index_and_unset_time_step) {
+    simulator.addAgent(Vector2(-1.f, 0.f), simulator.addGoal(Vector2(1.f, 0.f)));
+    simulator.buildIndex();
+    simulator.computeVelocities();
+
+    /** A robot added after building the index would be skipped **/
+    simulator.addAgent(Vector2(1.f, 0.f), simulator.addGoal(Vector2(-1.f, 0.f)));
+    EXPECT_THROW(simulator.computeVelocities(), std::runtime_error);
+    simulator.buildIndex();
+    EXPECT_NO_THROW(simulator.computeVelocities());
+
+    Simulator unset_simulator;
+    unset_simulator.setAgentDefaults(3.f, 30, ROBOT_RADIUS, ROBOT_RADIUS, 3.5f, 4.825f);
+    unset_simulator.addAgent(Vector2(0.f, 0.f), unset_simulator.addGoal(Vector2(1.f, 0.f)));
+    unset_simulator.buildIndex();
+    EXPECT_THROW(unset_simulator.computeVelocities(), std::runtime_error);
+}
+
+TEST_F(HRVOTest, 5_robots_in_vertical_line_with_external_integration) {
+    /** Integrates the new velocities outside the simulator, as an external physics engine would **/
+    const Vector2 goal_offset = Vector2(0.f, -6.f);
+    const Vector2 robot_offset = Vector2(0.f, -ROBOT_RADIUS * 2.5f);
+    for (std::size_t i = 0; i < 5; ++i) {
+        const Vector2 position = static_cast<float>(i) * robot_offset;
+        simulator.addAgent(position, simulator.addGoal(position + goal_offset));
+    }
+
+    for (int frame = 0; frame < 300 && !simulator.haveReachedGoals(); ++frame) {
+        simulator.buildIndex();
+        simulator.computeVelocities();
+        for (std::size_t robot_id = 0; robot_id < simulator.getNumAgents(); ++robot_id) {
+            const Vector2 velocity = simulator.getAgentNewVelocity(robot_id);
+            simulator.setAgentVelocity(robot_id, velocity);
+            simulator.setAgentPosition(robot_id, simulator.getAgentPosition(robot_id) + velocity * simulator.getTimeStep());
+        }
+        simulator.advanceTime(simulator.getTimeStep());
+    }
+    EXPECT_TRUE(simulator.haveReachedGoals());
+}
+
+TEST_F(HRVOTest, fast_forward_matches_steps) {
+    /** Robots cruising in separate lanes are fast-forwarded between accelerating and decelerating **/
+    Simulator stepped_simulator;
+    stepped_simulator.setTimeStep(simulator.getTimeStep());
+    stepped_simulator.setAgentDefaults(3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.5f, /*maxSpeed=*/4.825f, /*uncertaintyOffset=*/0.f, /*maxAccel=*/3.28f);
+    for (std::size_t i = 0; i < 3; ++i) {
+        const Vector2 position(-6.f, static_cast<float>(i) * 4.f);
+        simulator.addAgent(position, simulator.addGoal(position + Vector2(12.f, 0.f)));
+        stepped_simulator.addAgent(position, stepped_simulator.addGoal(position + Vector2(12.f, 0.f)));
+    }
+
+    const std::size_t num_frames = 150;
+    std::size_t num_skipped = 0;
+    for (std::size_t frame = 0; frame < num_frames;) {
+        const std::size_t skipped = simulator.fastForward(num_frames - frame);
+        if (skipped == 0) {
+            simulator.doStep();
+            ++frame;
+        }
+        frame += skipped;
+        num_skipped += skipped;
+    }
+    for (std::size_t frame = 0; frame < num_frames; ++frame) {
+        stepped_simulator.doStep();
+    }
+
+    EXPECT_GT(num_skipped, 0u);
+    EXPECT_NEAR(simulator.getGlobalTime(), stepped_simulator.getGlobalTime(), 1e-3f);
+    for (std::size_t robot_id = 0; robot_id < simulator.getNumAgents(); ++robot_id) {
+        EXPECT_NEAR(simulator.getAgentPosition(robot_id).getX(), stepped_simulator.getAgentPosition(robot_id).getX(), 5e-2f);
+        EXPECT_NEAR(simulator.getAgentPosition(robot_id).getY(), stepped_simulator.getAgentPosition(robot_id).getY(), 5e-2f);
+    }
+}
+
+TEST_F(HRVOTest, restored_snapshot_replays_steps) {
+    /** A robot visiting multiple goals crosses robots swapping sides; the scene is replayed from a snapshot **/
+    simulator.addAgent(Vector2(-4.f, -4.f), simulator.addGoalPositions({Vector2(4.f, -4.f), Vector2(4.f, 4.f), Vector2(-4.f, 4.f), Vector2(-4.f, -4.f)}));
+    for (std::size_t i = 0; i < 8; ++i) {
+        const Vector2 position(static_cast<float>(i) - 3.5f, 2.f);
+        simulator.addAgent(position, simulator.addGoal(-position));
+    }
+
+    for (int frame = 0; frame < 90; ++frame) {
+        simulator.doStep();
+    }
+
+    Snapshot snapshot;
+    simulator.saveSnapshot(snapshot);
+    EXPECT_EQ(snapshot.getNumAgents(), simulator.getNumAgents());
+    EXPECT_EQ(snapshot.getGlobalTime(), simulator.getGlobalTime());
+
+    std::vector<Vector2> positions;
+    for (int frame = 0; frame < 120; ++frame) {
+        simulator.doStep();
+    }
+    for (std::size_t robot_id = 0; robot_id < simulator.getNumAgents(); ++robot_id) {
+        positions.push_back(simulator.getAgentPosition(robot_id));
+    }
+
+    // Restoring removes a robot added after the snapshot was saved
+    simulator.addAgent(Vector2(8.f, 8.f), simulator.addGoal(Vector2(9.f, 8.f)));
+    simulator.doStep();
+
+    Simulator restored_simulator;
+    restored_simulator.restoreSnapshot(snapshot);
+    simulator.restoreSnapshot(snapshot);
+    EXPECT_EQ(simulator.getGlobalTime(), snapshot.getGlobalTime());
+    for (int frame = 0; frame < 120; ++frame) {
+        simulator.doStep();
+        restored_simulator.doStep();
+    }
+
+    ASSERT_EQ(restored_simulator.getNumAgents(), positions.size());
+    for (std::size_t robot_id = 0; robot_id < positions.size(); ++robot_id) {
+        EXPECT_EQ(simulator.getAgentPosition(robot_id), positions[robot_id]);
+        EXPECT_EQ(restored_simulator.getAgentPosition(robot_id), positions[robot_id]);
+    }
+}
+
+TEST_F(HRVOTest, restored_snapshot_replays_steps_with_decision_intervals) {
+    /** Same as 25_robots_around_circle_with_adaptive_time_step, but robots defer their decisions and the scene is replayed from a snapshot saved as they converge **/
+    simulator.setDecisionIntervals(0.2f, 0.5f);
+    simulator.setAdaptiveTimeStep(0.01f, 1.f/240);
+
+    const int num_robots = 25;
+    float robot_starting_angle_dif = HRVO_TWO_PI / num_robots;
+    float circle_radius = std::max(float(num_robots) / 10, 2.f);
+    for (std::size_t i = 0; i < num_robots; ++i) {
+        const Vector2 position = circle_radius * Vector2(std::cos(i * robot_starting_angle_dif), std::sin(i * robot_starting_angle_dif));
+        simulator.addAgent(position, simulator.addGoal(-position));
+    }
+
+    for (int frame = 0; frame < 40; ++frame) {
+        simulator.doStep();
+    }
+
+    Snapshot snapshot;
+    simulator.saveSnapshot(snapshot);
+
+    std::vector<Vector2> positions;
+    for (int frame = 0; frame < 60; ++frame) {
+        simulator.doStep();
+    }
+    for (std::size_t robot_id = 0; robot_id < simulator.getNumAgents(); ++robot_id) {
+        positions.push_back(simulator.getAgentPosition(robot_id));
+    }
+
+    // Robots whose decisions are not due at the snapshot keep their velocities and neighbors
+    Simulator restored_simulator;
+    restored_simulator.restoreSnapshot(snapshot);
+    simulator.restoreSnapshot(snapshot);
+    for (int frame = 0; frame < 60; ++frame) {
+        simulator.doStep();
+        restored_simulator.doStep();
+    }
+
+    ASSERT_EQ(restored_simulator.getNumAgents(), positions.size());
+    for (std::size_t robot_id = 0; robot_id < positions.size(); ++robot_id) {
+        EXPECT_EQ(simulator.getAgentPosition(robot_id), positions[robot_id]);
+        EXPECT_EQ(restored_simulator.getAgentPosition(robot_id), positions[robot_id]);
+    }
+}
+
+TEST_F(HRVOTest, rollouts_match_clone_steps) {
+    /** Robots swapping sides are predicted with their own goals and with each pair's goals exchanged **/
+    simulator.setNumThreads(4);
+    std::vector<std::size_t> goals;
+    for (std::size_t i = 0; i < 6; ++i) {
+        const Vector2 position(static_cast<float>(i) - 2.5f, 2.f);
+        goals.push_back(simulator.addGoal(-position));
+        simulator.addAgent(position, goals.back());
+    }
+
+    std::vector<Rollout> rollouts(2);
+    for (std::size_t i = 0; i < goals.size(); ++i) {
+        rollouts[1].setAgentGoal(i, goals[i ^ 1]);
+    }
+    simulator.runRollouts(rollouts, 2.f);
+
+    Simulator *const clone = simulator.clone();
+    for (int frame = 0; frame < 60 && !clone->haveReachedGoals(); ++frame) {
+        clone->doStep();
+    }
+
+    EXPECT_EQ(simulator.getGlobalTime(), 0.f);
+    EXPECT_EQ(simulator.getAgentPosition(0), Vector2(-2.5f, 2.f));
+    EXPECT_EQ(rollouts[0].getGlobalTime(), clone->getGlobalTime());
+    EXPECT_EQ(rollouts[0].haveReachedGoals(), clone->haveReachedGoals());
+    EXPECT_LT(rollouts[0].getMinClearance(), std::numeric_limits<float>::infinity());
+    EXPECT_NE(rollouts[0].getTotalDistToGoals(), rollouts[1].getTotalDistToGoals());
+    for (std::size_t robot_id = 0; robot_id < clone->getNumAgents(); ++robot_id) {
+        EXPECT_EQ(clone->getAgentGoal(robot_id), simulator.getAgentGoal(robot_id));
+    }
+
+    // The parameters shared with the clone are copied before either changes them
+    const float max_speed = simulator.getAgentMaxSpeed(1);
+    clone->setAgentMaxSpeed(0, 0.5f);
+    clone->setAgentDefaultKinematics(Simulator::KINEMATICS_OMNIDIRECTIONAL);
+    EXPECT_EQ(clone->getAgentMaxSpeed(0), 0.5f);
+    EXPECT_EQ(clone->getAgentMaxSpeed(1), max_speed);
+    EXPECT_EQ(simulator.getAgentMaxSpeed(0), max_speed);
+    EXPECT_EQ(simulator.addAgent(Vector2(0.f, -4.f), goals[0]), 6u);
+    EXPECT_EQ(simulator.getAgentKinematics(6), Simulator::KINEMATICS_HOLONOMIC);
+    delete clone;
+}
+
+TEST_F(HRVOTest, velocity_solver_matches_simulator) {
+    /** Four robots crossing at a junction; the velocity chosen for the first is recomputed without the simulator **/
+    for (std::size_t i = 0; i < 4; ++i) {
+        const Vector2 position = 1.5f * Vector2(std::cos(i * HRVO_TWO_PI / 4), std::sin(i * HRVO_TWO_PI / 4));
+        simulator.addAgent(position, simulator.addGoal(-position));
+    }
+    for (int frame = 0; frame < 10; ++frame) {
+        simulator.doStep();
+    }
+    simulator.buildIndex();
+    simulator.computeVelocities();
+    // Publishes the preferred velocities without moving the robots
+    simulator.advanceTime(0.f);
+
+    VelocitySolver::Query query;
+    query.position_ = simulator.getAgentPosition(0);
+    query.prefVelocity_ = simulator.getAgentPrefVelocity(0);
+    query.velocity_ = simulator.getAgentVelocity(0);
+    query.maxSpeed_ = simulator.getAgentMaxSpeed(0);
+    query.radius_ = simulator.getAgentRadius(0);
+    query.timeStep_ = simulator.getTimeStep();
+
+    // Neighbors in order of distance, as the simulator visits them
+    std::vector<VelocitySolver::Neighbor> neighbors(3);
+    for (std::size_t robot_id = 1; robot_id < 4; ++robot_id) {
+        neighbors[robot_id - 1].position_ = simulator.getAgentPosition(robot_id);
+        neighbors[robot_id - 1].prefVelocity_ = simulator.getAgentPrefVelocity(robot_id);
+        neighbors[robot_id - 1].velocity_ = simulator.getAgentVelocity(robot_id);
+        neighbors[robot_id - 1].radius_ = simulator.getAgentRadius(robot_id);
+    }
+    std::sort(neighbors.begin(), neighbors.end(), [&query](const VelocitySolver::Neighbor &a, const VelocitySolver::Neighbor &b) {
+        return absSq(a.position_ - query.position_) < absSq(b.position_ - query.position_);
+    });
+
+    VelocitySolver solver;
+    EXPECT_EQ(solver.computeVelocity(query, neighbors.data(), neighbors.size()), simulator.getAgentNewVelocity(0));
+    EXPECT_EQ(solver.getVelocityObstacles().size(), neighbors.size());
+    EXPECT_LE(solver.getActiveVelocityObstacles().size(), 2u);
+    EXPECT_EQ(solver.computeVelocity(query, NULL, 0), query.prefVelocity_);
+    EXPECT_TRUE(solver.getActiveVelocityObstacles().empty());
+}
+
+TEST_F(HRVOTest, robots_sharing_route_visit_every_waypoint) {
+    /** The second robot starts beside the first waypoint, which the first robot must still visit **/
+    const Vector2 first_waypoint(4.f, -4.f);
+    const std::size_t route = simulator.addGoalPositions({first_waypoint, Vector2(4.f, 4.f)});
+    simulator.addAgent(Vector2(-4.f, -4.f), route);
+    simulator.addAgent(Vector2(4.5f, -4.f), route);
+
+    float min_dist_to_first_waypoint = std::numeric_limits<float>::infinity();
+    for (int frame = 0; frame < 300; ++frame) {
+        simulator.doStep();
+        min_dist_to_first_waypoint = std::min(min_dist_to_first_waypoint, abs(simulator.getAgentPosition(0) - first_waypoint));
+    }
+
+    // Both robots end beside the last waypoint, which only one of them can occupy
+    EXPECT_LT(min_dist_to_first_waypoint, ROBOT_RADIUS * RADIUS_SCALE);
+    EXPECT_LT(abs(simulator.getAgentPosition(0) - Vector2(4.f, 4.f)), 4 * ROBOT_RADIUS * RADIUS_SCALE);
+    EXPECT_LT(abs(simulator.getAgentPosition(1) - Vector2(4.f, 4.f)), 4 * ROBOT_RADIUS * RADIUS_SCALE);
+    EXPECT_EQ(simulator.getGoalPosition(route), Vector2(4.f, 4.f));
+    EXPECT_THROW(simulator.addGoalPositions({}), std::runtime_error);
+}
+
+TEST_F(HRVOTest, robot_follows_navigation_grid_around_wall) {
+    /** A wall of blocked cells stands between the robot and its goal, with a gap only at the bottom **/
+    simulator.setNavigationGrid(Vector2(-5.f, -5.f), 20, 20, 0.5f);
+    const std::size_t goal = simulator.addGoal(Vector2(4.f, 2.f));
+    simulator.addAgent(Vector2(-4.f, 2.f), goal);
+
+    // The flow field is computed by the first step and repaired when the wall is built
+    simulator.doStep();
+    for (float y = -3.25f; y < 5.f; y += 0.5f) {
+        simulator.setNavigationGridCellBlocked(Vector2(0.25f, y), true);
+    }
+    EXPECT_TRUE(simulator.getNavigationGridCellBlocked(Vector2(0.25f, 2.f)));
+    EXPECT_FALSE(simulator.getNavigationGridCellBlocked(Vector2(0.25f, -3.75f)));
+    EXPECT_FALSE(simulator.getNavigationGridCellBlocked(Vector2(6.f, 2.f)));
+
+    bool entered_blocked_cell = false;
+    for (int frame = 0; frame < 300; ++frame) {
+        simulator.doStep();
+        entered_blocked_cell = entered_blocked_cell || simulator.getNavigationGridCellBlocked(simulator.getAgentPosition(0));
+    }
+    EXPECT_FALSE(entered_blocked_cell);
+    EXPECT_LT(abs(simulator.getAgentPosition(0) - Vector2(4.f, 2.f)), ROBOT_RADIUS * RADIUS_SCALE);
+
+    /** Opening a door in the wall once the robot heads back repairs the flow field of its goal to lead through it **/
+    simulator.setAgentGoalPosition(0, Vector2(-4.f, 2.f));
+    simulator.doStep();
+    simulator.setNavigationGridCellBlocked(Vector2(0.25f, 2.25f), false);
+
+    float min_dist_to_door = std::numeric_limits<float>::infinity();
+    for (int frame = 0; frame < 150; ++frame) {
+        simulator.doStep();
+        min_dist_to_door = std::min(min_dist_to_door, abs(simulator.getAgentPosition(0) - Vector2(0.25f, 2.25f)));
+    }
+    EXPECT_LT(min_dist_to_door, 0.25f);
+    EXPECT_LT(abs(simulator.getAgentPosition(0) - Vector2(-4.f, 2.f)), ROBOT_RADIUS * RADIUS_SCALE);
+}
+
+TEST_F(HRVOTest, robot_goal_position_is_moved_rather_than_added) {
+    simulator.addAgent(Vector2(0.f, 0.f), simulator.addGoal(Vector2(0.f, 0.f)));
+    for (int i = 0; i < 1000; ++i) {
+        simulator.setAgentGoalPosition(0, Vector2(static_cast<float>(i % 5), 1.f));
+    }
+    EXPECT_EQ(simulator.getNumGoals(), 2u);
+
+    /** A clone keeps the goal position it was cloned with **/
+    Simulator *const clone = simulator.clone();
+    simulator.setAgentGoalPosition(0, Vector2(-2.f, -1.f));
+    for (int frame = 0; frame < 120; ++frame) {
+        simulator.doStep();
+        clone->doStep();
+    }
+    EXPECT_LT(abs(simulator.getAgentPosition(0) - Vector2(-2.f, -1.f)), ROBOT_RADIUS * RADIUS_SCALE);
+    EXPECT_LT(abs(clone->getAgentPosition(0) - Vector2(4.f, 1.f)), ROBOT_RADIUS * RADIUS_SCALE);
+    EXPECT_EQ(simulator.getNumGoals(), 2u);
+    delete clone;
+
+    EXPECT_THROW(simulator.setAgentGoal(0, simulator.getNumGoals()), std::runtime_error);
+}
+
+TEST_F(HRVOTest, robot_tracks_trajectory_goal) {
+    /** The robot starts at rest on a trajectory that speeds up to the right and then curves up **/
+    Trajectory trajectory;
+    trajectory.addKnot(0.f, Vector2(-2.f, 0.f), Vector2(0.f, 0.f));
+    trajectory.addKnot(2.f, Vector2(1.f, 0.f), Vector2(1.5f, 0.f));
+    trajectory.addKnot(4.f, Vector2(2.f, 2.f), Vector2(0.f, 0.f));
+    EXPECT_THROW(trajectory.addKnot(4.f, Vector2(), Vector2()), std::runtime_error);
+    EXPECT_EQ(trajectory.getPosition(2.f), Vector2(1.f, 0.f));
+    EXPECT_EQ(trajectory.getVelocity(2.f), Vector2(1.5f, 0.f));
+    EXPECT_EQ(trajectory.getPosition(5.f), Vector2(2.f, 2.f));
+    EXPECT_THROW(simulator.addGoalTrajectory(Trajectory()), std::runtime_error);
+
+    simulator.addAgent(Vector2(-2.f, 0.f), simulator.addGoalTrajectory(trajectory));
+
+    float max_tracking_error = 0.f;
+    for (int frame = 0; frame < 150; ++frame) {
+        simulator.doStep();
+        max_tracking_error = std::max(max_tracking_error, abs(simulator.getAgentPosition(0) - trajectory.getPosition(simulator.getGlobalTime())));
+        EXPECT_FALSE(simulator.getAgentReachedGoal(0) && simulator.getGlobalTime() < trajectory.getEndTime());
+    }
+
+    // The velocity is fed forward, so the robot stays close without being told where to go at every step
+    EXPECT_LT(max_tracking_error, 0.1f);
+    EXPECT_LT(abs(simulator.getAgentPosition(0) - Vector2(2.f, 2.f)), ROBOT_RADIUS * RADIUS_SCALE);
+    EXPECT_TRUE(simulator.getAgentReachedGoal(0));
+
+    /** From a start off the trajectory, a longer tracking time of the goal closes the gap more slowly **/
+    EXPECT_EQ(trajectory.getTrackingTime(), 0.25f);
+    EXPECT_THROW(trajectory.setTrackingTime(0.f), std::runtime_error);
+    Trajectory loose_trajectory = trajectory;
+    loose_trajectory.setTrackingTime(1.f);
+    float gaps[2];
+    for (int loose = 0; loose < 2; ++loose) {
+        Simulator offset_simulator;
+        offset_simulator.setTimeStep(1.f/30);
+        offset_simulator.setAgentDefaults(3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.5f, /*maxSpeed=*/4.825f, /*uncertaintyOffset=*/0.f, /*maxAccel=*/3.28f);
+        offset_simulator.addAgent(Vector2(-2.f, 0.5f), offset_simulator.addGoalTrajectory(loose != 0 ? loose_trajectory : trajectory));
+        for (int frame = 0; frame < 15; ++frame) {
+            offset_simulator.doStep();
+        }
+        gaps[loose] = abs(offset_simulator.getAgentPosition(0) - trajectory.getPosition(offset_simulator.getGlobalTime()));
+    }
+    EXPECT_LT(gaps[0], gaps[1]);
+}
+
+TEST_F(HRVOTest, bulk_agent_state_matches_single_agent_calls) {
+    /** Robots added and read in bulk behave exactly as those added and read one at a time **/
+    Simulator single_simulator;
+    single_simulator.setTimeStep(1.f/30);
+    single_simulator.setAgentDefaults(3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.5f, /*maxSpeed=*/4.825f, /*uncertaintyOffset=*/0.f, /*maxAccel=*/3.28f);
+
+    std::vector<Vector2> positions;
+    std::vector<std::size_t> goals;
+    for (int i = 0; i < 8; ++i) {
+        positions.push_back(Vector2(i * 0.5f, 0.f));
+        goals.push_back(simulator.addGoal(Vector2(3.5f - i * 0.5f, 1.f)));
+        single_simulator.addAgent(positions.back(), single_simulator.addGoal(Vector2(3.5f - i * 0.5f, 1.f)));
+    }
+    std::vector<std::size_t> agent_nos(positions.size());
+    simulator.addAgents(positions.data(), goals.data(), positions.size(), agent_nos.data());
+    for (std::size_t i = 0; i < agent_nos.size(); ++i) {
+        EXPECT_EQ(agent_nos[i], i);
+    }
+    EXPECT_EQ(simulator.getNumAgents(), positions.size());
+
+    const std::vector<Vector2> velocities(positions.size(), Vector2(0.5f, 0.5f));
+    simulator.setAgentVelocities(0, velocities.size(), velocities.data());
+    for (std::size_t i = 0; i < velocities.size(); ++i) {
+        single_simulator.setAgentVelocity(i, velocities[i]);
+    }
+
+    std::vector<Vector2> bulk_positions(positions.size());
+    std::vector<Vector2> bulk_velocities(positions.size());
+    for (int frame = 0; frame < 60; ++frame) {
+        simulator.doStep();
+        single_simulator.doStep();
+        simulator.getAgentPositions(0, bulk_positions.size(), bulk_positions.data());
+        simulator.getAgentVelocities(0, bulk_velocities.size(), bulk_velocities.data());
+        for (std::size_t i = 0; i < positions.size(); ++i) {
+            EXPECT_EQ(bulk_positions[i], single_simulator.getAgentPosition(i));
+            EXPECT_EQ(bulk_velocities[i], single_simulator.getAgentVelocity(i));
+        }
+    }
+
+    EXPECT_THROW(simulator.getAgentPositions(4, positions.size(), bulk_positions.data()), std::runtime_error);
+    EXPECT_THROW(simulator.setAgentVelocities(1, velocities.size(), velocities.data()), std::runtime_error);
+    const std::size_t missing_goal = simulator.getNumGoals();
+    EXPECT_THROW(simulator.addAgents(positions.data(), &missing_goal, 1), std::runtime_error);
+    EXPECT_EQ(simulator.getNumAgents(), positions.size());
+}
+
+TEST_F(HRVOTest, removed_robot_is_ignored_and_its_number_reused) {
+    /** A robot is removed from the path of another, with neighbors found both by brute force and with a k-D tree **/
+    for (std::size_t threshold : {std::size_t(0), std::size_t(64)}) {
+        Simulator sim;
+        sim.setTimeStep(1.f/30);
+        sim.setNeighborBruteForceThreshold(threshold);
+        sim.setAgentDefaults(3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.5f, /*maxSpeed=*/4.825f, /*uncertaintyOffset=*/0.f, /*maxAccel=*/3.28f);
+
+        sim.addAgent(Vector2(-2.f, 0.f), sim.addGoal(Vector2(2.f, 0.f)));
+        const AgentHandle blocker = sim.getAgentHandle(sim.addAgent(Vector2(0.f, 0.f), sim.addGoal(Vector2(0.f, 0.f))));
+        sim.addAgent(Vector2(0.f, 2.5f), sim.addGoal(Vector2(0.f, 2.f)));
+        sim.removeAgent(blocker);
+        EXPECT_FALSE(sim.hasAgent(blocker));
+        EXPECT_THROW(sim.removeAgent(blocker), std::runtime_error);
+        EXPECT_THROW(sim.getAgentNo(blocker), std::runtime_error);
+        EXPECT_EQ(sim.getNumAgents(), 3u);
+        EXPECT_EQ(sim.getNumLiveAgents(), 2u);
+
+        // The first robot drives straight through the position of the removed robot
+        float max_deviation = 0.f;
+        for (int frame = 0; frame < 90; ++frame) {
+            sim.doStep();
+            max_deviation = std::max(max_deviation, std::abs(sim.getAgentPosition(0).getY()));
+        }
+        EXPECT_EQ(max_deviation, 0.f);
+        EXPECT_LT(abs(sim.getAgentPosition(0) - Vector2(2.f, 0.f)), ROBOT_RADIUS * RADIUS_SCALE);
+        EXPECT_TRUE(sim.haveReachedGoals());
+
+        // A new robot takes the number of the removed robot, but not its handles
+        const std::size_t agentNo = sim.addAgent(Vector2(0.f, -2.f), sim.addGoal(Vector2(0.f, 3.f)));
+        const AgentHandle handle = sim.getAgentHandle(agentNo);
+        EXPECT_EQ(agentNo, blocker.getAgentNo());
+        EXPECT_NE(handle, blocker);
+        EXPECT_FALSE(sim.hasAgent(blocker));
+        EXPECT_EQ(sim.getAgentNo(handle), agentNo);
+        EXPECT_EQ(sim.getNumAgents(), 3u);
+        EXPECT_EQ(sim.getNumLiveAgents(), 3u);
+
+        // The new robot avoids the robot parked in its path
+        float min_dist = std::numeric_limits<float>::infinity();
+        for (int frame = 0; frame < 150; ++frame) {
+            sim.doStep();
+            min_dist = std::min(min_dist, abs(sim.getAgentPosition(agentNo) - sim.getAgentPosition(2)));
+        }
+        EXPECT_GT(min_dist, 2 * ROBOT_RADIUS * RADIUS_SCALE);
+
+        // Robots added in bulk take the freed numbers first, which need not be consecutive
+        sim.removeAgent(sim.getAgentHandle(2));
+        sim.removeAgent(sim.getAgentHandle(0));
+        const Vector2 positions[3] = {Vector2(-3.f, -3.f), Vector2(-3.f, 3.f), Vector2(3.f, -3.f)};
+        const std::size_t goals[3] = {sim.addGoal(Vector2(-3.f, -2.f)), sim.addGoal(Vector2(-3.f, 2.f)), sim.addGoal(Vector2(3.f, -2.f))};
+        std::size_t agent_nos[3];
+        sim.addAgents(positions, goals, 3, agent_nos);
+        EXPECT_EQ(agent_nos[0], 0u);
+        EXPECT_EQ(agent_nos[1], 2u);
+        EXPECT_EQ(agent_nos[2], 3u);
+        for (std::size_t i = 0; i < 3; ++i) {
+            EXPECT_EQ(sim.getAgentPosition(agent_nos[i]), positions[i]);
+        }
+        EXPECT_EQ(sim.getNumAgents(), 4u);
+        EXPECT_EQ(sim.getNumLiveAgents(), 4u);
+    }
+}
+
+TEST_F(HRVOTest, robots_share_agent_profile_with_overrides) {
+    /** Robots added with a profile follow changes to it, except for the properties set on them **/
+    Simulator sim;
+    sim.setTimeStep(1.f/30);
+    sim.setAgentDefaults(3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.5f, /*maxSpeed=*/4.825f, /*uncertaintyOffset=*/0.f, /*maxAccel=*/3.28f);
+    const std::size_t slow = sim.addAgentProfile("slow", 3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/1.f, /*maxSpeed=*/1.5f);
+    const std::size_t fast = sim.addAgentProfile("fast", 3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.5f, /*maxSpeed=*/4.825f);
+    EXPECT_THROW(sim.addAgentProfile("slow", 1.f, 10, 0.1f, 0.1f, 1.f, 1.f), std::runtime_error);
+    EXPECT_EQ(sim.getNumAgentProfiles(), 2u);
+    EXPECT_EQ(sim.getAgentProfileNo("fast"), fast);
+    EXPECT_THROW(sim.getAgentProfileNo("medium"), std::runtime_error);
+
+    const std::size_t unprofiled = sim.addAgent(Vector2(0.f, -2.f), sim.addGoal(Vector2(0.f, 2.f)));
+    const std::size_t first = sim.addAgent(Vector2(-2.f, 0.f), sim.addGoal(Vector2(2.f, 0.f)), slow);
+    const std::size_t second = sim.addAgent(Vector2(2.f, 1.f), sim.addGoal(Vector2(-2.f, 1.f)), slow);
+    EXPECT_THROW(sim.addAgent(Vector2(), 0, 2), std::runtime_error);
+    EXPECT_EQ(sim.getAgentProfile(unprofiled), Simulator::HRVO_NO_AGENT_PROFILE);
+    EXPECT_EQ(sim.getAgentProfile(first), slow);
+    EXPECT_EQ(sim.getAgentMaxSpeed(first), 1.5f);
+
+    // The override on the second robot outlives changes to its profile
+    sim.setAgentMaxSpeed(second, 2.f);
+    sim.setAgentProfileProperties(slow, 3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/1.25f, /*maxSpeed=*/1.75f);
+    EXPECT_EQ(sim.getAgentPrefSpeed(first), 1.25f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(first), 1.75f);
+    EXPECT_EQ(sim.getAgentPrefSpeed(second), 1.25f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(second), 2.f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(unprofiled), 4.825f);
+
+    // Robots added with the defaults keep them when the defaults change, and an override on one leaves the others
+    const std::size_t later = sim.addAgent(Vector2(0.f, 2.f), sim.addGoal(Vector2(0.f, -2.f)));
+    sim.setAgentDefaults(3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/1.f, /*maxSpeed=*/1.f);
+    sim.setAgentPrefSpeed(later, 2.f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(later), 4.825f);
+    EXPECT_EQ(sim.getAgentPrefSpeed(later), 2.f);
+    EXPECT_EQ(sim.getAgentPrefSpeed(unprofiled), 3.5f);
+
+    // Changing the profile of a robot drops its overrides
+    sim.setAgentProfile(second, fast);
+    EXPECT_EQ(sim.getAgentProfile(second), fast);
+    EXPECT_EQ(sim.getAgentMaxSpeed(second), 4.825f);
+
+    // Profiles are restored with the rest of the simulation
+    Snapshot snapshot;
+    sim.saveSnapshot(snapshot);
+    sim.setAgentProfileProperties(slow, 3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/0.5f, /*maxSpeed=*/0.5f);
+    sim.restoreSnapshot(snapshot);
+    EXPECT_EQ(sim.getAgentMaxSpeed(first), 1.75f);
+    sim.setAgentProfileProperties(slow, 3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/1.25f, /*maxSpeed=*/1.f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(first), 1.f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(second), 4.825f);
+
+    for (int frame = 0; frame < 30; ++frame) {
+        sim.doStep();
+        EXPECT_LE(abs(sim.getAgentVelocity(first)), 1.f + 1e-4f);
+    }
+
+    // Robots of several profiles and the defaults are added in one call, and nothing is added if any profile is missing
+    const Vector2 positions[3] = {Vector2(-4.f, -4.f), Vector2(-4.f, 4.f), Vector2(4.f, -4.f)};
+    const std::size_t goals[3] = {sim.addGoal(Vector2(-4.f, -3.f)), sim.addGoal(Vector2(-4.f, 3.f)), sim.addGoal(Vector2(4.f, -3.f))};
+    const std::size_t profiles[3] = {slow, Simulator::HRVO_NO_AGENT_PROFILE, fast};
+    const std::size_t missing_profiles[3] = {slow, fast, sim.getNumAgentProfiles()};
+    const std::size_t num_agents = sim.getNumAgents();
+    EXPECT_THROW(sim.addAgents(positions, goals, missing_profiles, 3), std::runtime_error);
+    EXPECT_EQ(sim.getNumAgents(), num_agents);
+    std::size_t agent_nos[3];
+    sim.addAgents(positions, goals, profiles, 3, agent_nos);
+    for (std::size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(sim.getAgentProfile(agent_nos[i]), profiles[i]);
+        EXPECT_EQ(sim.getAgentPosition(agent_nos[i]), positions[i]);
+    }
+    EXPECT_EQ(sim.getAgentMaxSpeed(agent_nos[0]), 1.f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(agent_nos[1]), 1.f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(agent_nos[2]), 4.825f);
+
+    // The robots added with a profile follow later changes to it
+    sim.setAgentProfileProperties(fast, 3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/3.f, /*maxSpeed=*/4.f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(agent_nos[2]), 4.f);
+    EXPECT_EQ(sim.getAgentMaxSpeed(second), 4.f);
+}
+
+TEST_F(HRVOTest, mixed_kinematic_models_reach_goals) {
+    /** Holonomic, differential-drive, and omnidirectional robots share one simulation **/
+    Simulator sim;
+    const float timeStep = 1.f/30;
+    const float maxAccel = 3.28f;
+    sim.setTimeStep(timeStep);
+    sim.setAgentDefaults(3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/1.5f, /*maxSpeed=*/2.f, /*uncertaintyOffset=*/0.f, maxAccel);
+    const std::size_t omni = sim.addAgentProfile("omni", 3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, /*prefSpeed=*/1.5f, /*maxSpeed=*/2.f, /*uncertaintyOffset=*/0.f, maxAccel);
+    sim.setAgentProfileKinematics(omni, Simulator::KINEMATICS_OMNIDIRECTIONAL);
+
+    const std::size_t holonomic = sim.addAgent(Vector2(-2.f, 0.f), sim.addGoal(Vector2(2.f, 0.f)));
+    const std::size_t omnidirectional = sim.addAgent(Vector2(0.f, -2.f), sim.addGoal(Vector2(0.f, 2.f)), omni);
+
+    // A differential-drive robot needs a positive time to orientation and wheel track
+    EXPECT_THROW(sim.setAgentDefaultKinematics(Simulator::KINEMATICS_DIFFERENTIAL_DRIVE), std::runtime_error);
+    EXPECT_THROW(sim.setAgentDefaultKinematics(Simulator::KINEMATICS_DIFFERENTIAL_DRIVE, /*timeToOrientation=*/0.f, /*wheelTrack=*/0.1f), std::runtime_error);
+    EXPECT_THROW(sim.setAgentProfileKinematics(omni, Simulator::KINEMATICS_DIFFERENTIAL_DRIVE), std::runtime_error);
+    EXPECT_THROW(sim.setAgentProfileKinematics(omni, Simulator::KINEMATICS_DIFFERENTIAL_DRIVE, /*timeToOrientation=*/0.25f, /*wheelTrack=*/-0.1f), std::runtime_error);
+    EXPECT_THROW(sim.setAgentKinematics(holonomic, Simulator::KINEMATICS_DIFFERENTIAL_DRIVE), std::runtime_error);
+
+    // A robot that keeps a wheel track of its own, which only a differential-drive robot needs, holds its profile back from that model
+    sim.setAgentWheelTrack(omnidirectional, 0.f);
+    EXPECT_THROW(sim.setAgentProfileKinematics(omni, Simulator::KINEMATICS_DIFFERENTIAL_DRIVE, /*timeToOrientation=*/0.25f, /*wheelTrack=*/0.1f), std::runtime_error);
+    EXPECT_EQ(sim.getAgentKinematics(omnidirectional), Simulator::KINEMATICS_OMNIDIRECTIONAL);
+    EXPECT_EQ(sim.getAgentKinematics(holonomic), Simulator::KINEMATICS_HOLONOMIC);
+    EXPECT_EQ(sim.getAgentKinematics(omnidirectional), Simulator::KINEMATICS_OMNIDIRECTIONAL);
+
+    sim.setAgentDefaultKinematics(Simulator::KINEMATICS_DIFFERENTIAL_DRIVE, /*timeToOrientation=*/0.25f, /*wheelTrack=*/0.1f);
+    const std::size_t differentialDrive = sim.addAgent(Vector2(2.f, 2.f), sim.addGoal(Vector2(-2.f, -2.f)));
+    EXPECT_THROW(sim.setAgentWheelTrack(differentialDrive, 0.f), std::runtime_error);
+    EXPECT_THROW(sim.setAgentTimeToOrientation(differentialDrive, -0.25f), std::runtime_error);
+    EXPECT_EQ(sim.getAgentKinematics(holonomic), Simulator::KINEMATICS_HOLONOMIC);
+    EXPECT_EQ(sim.getAgentKinematics(omnidirectional), Simulator::KINEMATICS_OMNIDIRECTIONAL);
+    EXPECT_EQ(sim.getAgentKinematics(differentialDrive), Simulator::KINEMATICS_DIFFERENTIAL_DRIVE);
+    EXPECT_EQ(sim.getAgentWheelTrack(differentialDrive), 0.1f);
+
+    Snapshot snapshot;
+    sim.saveSnapshot(snapshot);
+
+    for (int frame = 0; frame < 600 && !sim.haveReachedGoals(); ++frame) {
+        const Vector2 velocity = sim.getAgentVelocity(omnidirectional);
+        sim.doStep();
+
+        // The omnidirectional robot accelerates at most at the limit along each axis
+        const Vector2 dv = sim.getAgentVelocity(omnidirectional) - velocity;
+        EXPECT_LE(std::abs(dv.getX()), maxAccel * timeStep + 1e-5f);
+        EXPECT_LE(std::abs(dv.getY()), maxAccel * timeStep + 1e-5f);
+
+        // The differential-drive robot moves along its orientation
+        const float orientation = sim.getAgentOrientation(differentialDrive);
+        EXPECT_LT(std::abs(det(Vector2(std::cos(orientation), std::sin(orientation)), sim.getAgentVelocity(differentialDrive))), 1e-5f);
+    }
+    EXPECT_TRUE(sim.haveReachedGoals());
+
+    // The kinematic models are restored with the rest of the simulation
+    sim.setAgentKinematics(differentialDrive, Simulator::KINEMATICS_HOLONOMIC);
+    sim.restoreSnapshot(snapshot);
+    EXPECT_EQ(sim.getAgentKinematics(differentialDrive), Simulator::KINEMATICS_DIFFERENTIAL_DRIVE);
+}
+
+TEST_F(HRVOTest, truncated_velocity_obstacle_admits_slow_velocities) {
+    /** A static robot 3 m ahead is only reached within a 1 s time horizon at 2 m/s or more **/
+    VelocitySolver::Query query;
+    query.maxSpeed_ = 3.f;
+    query.radius_ = 0.5f;
+    query.timeHorizon_ = 1.f;
+    query.timeStep_ = simulator.getTimeStep();
+
+    VelocitySolver::Neighbor neighbor;
+    neighbor.position_ = Vector2(3.f, 0.f);
+    neighbor.radius_ = 0.5f;
+
+    // The velocity obstacle is cut off where the sides meet the velocities that collide at the time horizon
+    VelocitySolver solver;
+    query.prefVelocity_ = Vector2(1.f, 0.f);
+    EXPECT_EQ(solver.computeVelocity(query, &neighbor, 1), query.prefVelocity_);
+    ASSERT_EQ(solver.getVelocityObstacles().size(), 1u);
+    EXPECT_NEAR(solver.getVelocityObstacles()[0].cutoff_ * solver.getVelocityObstacles()[0].side1_.getX(), 2.f, 1e-4f);
+
+    // A faster preferred velocity is moved back onto the cutoff segment rather than onto a side
+    query.prefVelocity_ = Vector2(2.5f, 0.f);
+    const Vector2 velocity = solver.computeVelocity(query, &neighbor, 1);
+    EXPECT_NEAR(velocity.getX(), 2.f, 1e-4f);
+    EXPECT_NEAR(velocity.getY(), 0.f, 1e-4f);
+    EXPECT_EQ(solver.getActiveVelocityObstacles().size(), 1u);
+
+    // Without a time horizon the slow preferred velocity is moved onto a side
+    query.prefVelocity_ = Vector2(1.f, 0.f);
+    query.timeHorizon_ = std::numeric_limits<float>::infinity();
+    EXPECT_GT(std::abs(solver.computeVelocity(query, &neighbor, 1).getY()), 0.3f);
+    EXPECT_EQ(solver.getVelocityObstacles()[0].cutoff_, 0.f);
+
+    // With two robots ahead the velocity chosen lies outside both truncated velocity obstacles
+    std::vector<VelocitySolver::Neighbor> neighbors(2, neighbor);
+    neighbors[0].position_ = Vector2(3.f, 0.5f);
+    neighbors[1].position_ = Vector2(3.f, -0.5f);
+    query.prefVelocity_ = Vector2(2.5f, 0.f);
+    query.timeHorizon_ = 1.f;
+    const Vector2 velocity_between = solver.computeVelocity(query, neighbors.data(), neighbors.size());
+    EXPECT_LT(abs(velocity_between), query.maxSpeed_);
+    for (const VelocitySolver::VelocityObstacle &velocity_obstacle : solver.getVelocityObstacles()) {
+        const Vector2 offset = velocity_between - velocity_obstacle.apex_;
+        const bool inside = det(velocity_obstacle.side2_, offset) < -1e-4f && det(velocity_obstacle.side1_, offset) > 1e-4f && det(velocity_obstacle.side2_ - velocity_obstacle.side1_, offset - velocity_obstacle.cutoff_ * velocity_obstacle.side1_) < -1e-4f;
+        EXPECT_FALSE(inside);
+        EXPECT_GT(velocity_obstacle.cutoff_, 0.f);
+    }
+}
+
+TEST_F(HRVOTest, clustered_far_neighbors_bound_their_velocity_obstacles) {
+    /** Robots beyond the cluster distance set by the defaults share a velocity obstacle; nearer robots keep their own **/
+    simulator.setAgentDefaults(10.f, 30, 0.25f, 0.25f, /*prefSpeed=*/1.f, /*maxSpeed=*/2.f, /*uncertaintyOffset=*/0.f, /*maxAccel=*/2.f, Vector2(), 0.f, std::numeric_limits<float>::infinity(), /*clusterDist=*/3.f);
+    const std::size_t robot = simulator.addAgent(Vector2(0.f, 0.f), simulator.addGoal(Vector2(5.f, 0.f)));
+    EXPECT_EQ(simulator.getAgentClusterDist(robot), 3.f);
+    const std::size_t profile = simulator.addAgentProfile("clustered", 10.f, 30, 0.25f, 0.25f, 1.f, 2.f, 0.f, 2.f, Vector2(), 0.f, std::numeric_limits<float>::infinity(), 4.f);
+    const std::size_t profiled_robot = simulator.addAgent(Vector2(0.f, -8.f), simulator.addGoal(Vector2(5.f, -8.f)), profile);
+    EXPECT_EQ(simulator.getAgentClusterDist(profiled_robot), 4.f);
+    simulator.setAgentProfileProperties(profile, 10.f, 30, 0.25f, 0.25f, 1.f, 2.f, 0.f, 2.f, Vector2(), 0.f, std::numeric_limits<float>::infinity(), 5.f);
+    EXPECT_EQ(simulator.getAgentClusterDist(profiled_robot), 5.f);
+
+    VelocitySolver::Query query;
+    query.prefVelocity_ = Vector2(1.f, 0.f);
+    query.maxSpeed_ = 2.f;
+    query.radius_ = 0.25f;
+    query.timeStep_ = simulator.getTimeStep();
+
+    // One near robot ahead, and a group of far robots moving together to the left
+    std::vector<VelocitySolver::Neighbor> neighbors(4);
+    neighbors[0].position_ = Vector2(1.5f, 0.5f);
+    neighbors[1].position_ = Vector2(6.f, 1.f);
+    neighbors[2].position_ = Vector2(6.5f, 1.6f);
+    neighbors[3].position_ = Vector2(6.2f, 2.2f);
+    for (VelocitySolver::Neighbor &neighbor : neighbors) {
+        neighbor.radius_ = 0.25f;
+        neighbor.velocity_ = Vector2(-0.5f, 0.f);
+        neighbor.prefVelocity_ = neighbor.velocity_;
+    }
+    neighbors[0].velocity_ = Vector2(0.f, 0.f);
+    neighbors[0].prefVelocity_ = Vector2(0.f, 0.f);
+
+    VelocitySolver exact_solver;
+    exact_solver.computeVelocity(query, neighbors.data(), neighbors.size());
+    const std::vector<VelocitySolver::VelocityObstacle> exact = exact_solver.getVelocityObstacles();
+    ASSERT_EQ(exact.size(), neighbors.size());
+
+    query.clusterDist_ = 3.f;
+    VelocitySolver clustered_solver;
+    clustered_solver.computeVelocity(query, neighbors.data(), neighbors.size());
+    const std::vector<VelocitySolver::VelocityObstacle> &clustered = clustered_solver.getVelocityObstacles();
+    ASSERT_EQ(clustered.size(), 2u);
+
+    // The near robot keeps its exact velocity obstacle
+    EXPECT_EQ(clustered[0].apex_, exact[0].apex_);
+    EXPECT_EQ(clustered[0].side1_, exact[0].side1_);
+    EXPECT_EQ(clustered[0].side2_, exact[0].side2_);
+
+    // The velocity obstacle of the cluster contains the apex and both sides of each member
+    const VelocitySolver::VelocityObstacle &cluster = clustered[1];
+    for (std::size_t i = 1; i < exact.size(); ++i) {
+        EXPECT_LE(det(cluster.side2_, exact[i].apex_ - cluster.apex_), 1e-4f);
+        EXPECT_GE(det(cluster.side1_, exact[i].apex_ - cluster.apex_), -1e-4f);
+        EXPECT_GE(det(cluster.side1_, exact[i].side1_), -1e-5f);
+        EXPECT_GE(det(exact[i].side2_, cluster.side2_), -1e-5f);
+    }
+}
+
+TEST_F(HRVOTest, neighbor_auto_tuning_keeps_trajectories_and_restores_threshold) {
+    /** Rows of robots cross with and without a tuned neighbor index; tuning tries every configuration before it locks one in **/
+    Simulator untuned_simulator;
+    untuned_simulator.setTimeStep(simulator.getTimeStep());
+    untuned_simulator.setAgentDefaults(3.f, 30, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, 3.5f, 4.825f, 0.f, 3.28f);
+    for (std::size_t i = 0; i < 60; ++i) {
+        const Vector2 position(static_cast<float>(i % 10) - 4.5f, static_cast<float>(i / 10) - 2.5f);
+        simulator.addAgent(position, simulator.addGoal(Vector2(-position.getX(), position.getY() + 0.5f)));
+        untuned_simulator.addAgent(position, untuned_simulator.addGoal(Vector2(-position.getX(), position.getY() + 0.5f)));
+    }
+
+    simulator.setNeighborBruteForceThreshold(7);
+    simulator.setNeighborAutoTuning(true);
+    EXPECT_TRUE(simulator.getNeighborAutoTuning());
+    for (int frame = 0; frame < 60; ++frame) {
+        simulator.doStep();
+        untuned_simulator.doStep();
+    }
+    for (std::size_t robot_id = 0; robot_id < simulator.getNumAgents(); ++robot_id) {
+        EXPECT_EQ(simulator.getAgentPosition(robot_id), untuned_simulator.getAgentPosition(robot_id));
+    }
+
+    // A threshold set while tuning takes effect once tuning is disabled
+    EXPECT_EQ(simulator.getNeighborBruteForceThreshold(), 7u);
+    simulator.setNeighborBruteForceThreshold(9);
+    simulator.setNeighborAutoTuning(false);
+    EXPECT_FALSE(simulator.getNeighborAutoTuning());
+    EXPECT_EQ(simulator.getNeighborBruteForceThreshold(), 9u);
+}
+
+TEST_F(HRVOTest, neighbor_surface_distances_match_between_brute_force_and_k_d_tree) {
+    /** Rows of robots and obstacles of mixed radii cross using surface distances; brute force, the k-D tree and a tuned index find the same neighbors **/
+    Simulator tree_simulator;
+    Simulator tuned_simulator;
+    for (Simulator *sim : {&simulator, &tree_simulator, &tuned_simulator}) {
+        sim->setTimeStep(simulator.getTimeStep());
+        sim->setAgentDefaults(1.5f, 10, ROBOT_RADIUS * RADIUS_SCALE, ROBOT_RADIUS * RADIUS_SCALE, 3.5f, 4.825f, 0.f, 3.28f);
+        sim->setNeighborSurfaceDistance(true);
+        for (std::size_t i = 0; i < 120; ++i) {
+            const Vector2 position(static_cast<float>(i % 12) * 0.7f - 3.85f, static_cast<float>(i / 12) * 0.7f - 3.15f);
+            const std::size_t robot_id = sim->addAgent(position, sim->addGoal(Vector2(-position.getX(), position.getY() + 0.35f)));
+            sim->setAgentRadius(robot_id, 0.07f + 0.037f * static_cast<float>(i % 9));
+        }
+    }
+
+    simulator.setNeighborBruteForceThreshold(1000);
+    tree_simulator.setNeighborBruteForceThreshold(0);
+    tuned_simulator.setNeighborAutoTuning(true);
+    for (int frame = 0; frame < 60; ++frame) {
+        simulator.doStep();
+        tree_simulator.doStep();
+        tuned_simulator.doStep();
+    }
+    for (std::size_t robot_id = 0; robot_id < simulator.getNumAgents(); ++robot_id) {
+        EXPECT_EQ(tree_simulator.getAgentPosition(robot_id), simulator.getAgentPosition(robot_id));
+        EXPECT_EQ(tuned_simulator.getAgentPosition(robot_id), simulator.getAgentPosition(robot_id));
+    }
+
+    // Two robots head for each other with the surface of the other exactly at their neighbor distance, where the order in which the radii are subtracted decides whether it is found
+    Simulator brute_force_pair;
+    Simulator tree_pair;
+    for (Simulator *sim : {&brute_force_pair, &tree_pair}) {
+        sim->setTimeStep(simulator.getTimeStep());
+        sim->setNeighborSurfaceDistance(true);
+        sim->addAgent(Vector2(-1.f, 0.f), sim->addGoal(Vector2(3.f, 0.f)), 1.78830004f, 10, 0.1f, 0.1f, 1.f, 1.f);
+        sim->addAgent(Vector2(1.f, 0.f), sim->addGoal(Vector2(-3.f, 0.f)), 1.78830004f, 10, 0.1117f, 0.1f, 1.f, 1.f);
+    }
+
+    brute_force_pair.setNeighborBruteForceThreshold(1000);
+    tree_pair.setNeighborBruteForceThreshold(0);
+    brute_force_pair.doStep();
+    tree_pair.doStep();
+    for (std::size_t robot_id = 0; robot_id < 2; ++robot_id) {
+        EXPECT_EQ(tree_pair.getAgentVelocity(robot_id), brute_force_pair.getAgentVelocity(robot_id));
+    }
+}
+
+TEST_F(HRVOTest, fast_math_approximations_stay_within_error_bounds) {
+    /** Each approximation is swept against the double-precision library and held to the maximum error stated for it **/
+    const int num_samples = 1000000;
+
+    float max_error = 0.f;
+    for (int i = -num_samples; i <= num_samples; ++i) {
+        const float scalar = static_cast<float>(i) / num_samples;
+        max_error = std::max(max_error, static_cast<float>(std::fabs(approxAsin(scalar) - std::asin(static_cast<double>(scalar)))));
+    }
+    EXPECT_LE(max_error, 3e-7f);
+
+    // Points on circles of several radii cover every octant, with the angles of the axes and diagonals included
+    max_error = 0.f;
+    for (int i = 0; i < num_samples; ++i) {
+        const double angle = -HRVO_PI + HRVO_TWO_PI * i / num_samples;
+        for (double radius : {1e-3, 1.0, 1e3}) {
+            const float y = static_cast<float>(radius * std::sin(angle));
+            const float x = static_cast<float>(radius * std::cos(angle));
+            max_error = std::max(max_error, static_cast<float>(std::fabs(approxAtan2(y, x) - std::atan2(static_cast<double>(y), static_cast<double>(x)))));
+        }
+    }
+    EXPECT_LE(max_error, 2.1e-6f);
+
+    // Signed zeros select the same half-plane, and the same sign of a zero angle, as the library
+    for (float y : {0.f, -0.f, 1.f, -1.f}) {
+        for (float x : {0.f, -0.f, 1.f, -1.f}) {
+            if (y == 0.f || x == 0.f) {
+                const float angle = approxAtan2(y, x);
+                EXPECT_NEAR(angle, std::atan2(y, x), 2.1e-6f) << "y = " << y << ", x = " << x;
+                EXPECT_EQ(std::signbit(angle), std::signbit(std::atan2(y, x))) << "y = " << y << ", x = " << x;
+            }
+        }
+    }
+
+    // Angles within [-1000, 1000], and then angles in each negative quadrant more finely
+    max_error = 0.f;
+    for (int i = -num_samples; i <= num_samples; ++i) {
+        for (float angle : {1000.f * i / num_samples, HRVO_TWO_PI * i / num_samples}) {
+            float sine;
+            float cosine;
+            approxSinCos(angle, sine, cosine);
+            max_error = std::max(max_error, static_cast<float>(std::fabs(sine - std::sin(static_cast<double>(angle)))));
+            max_error = std::max(max_error, static_cast<float>(std::fabs(cosine - std::cos(static_cast<double>(angle)))));
+        }
+    }
+    EXPECT_LE(max_error, 1e-7f);
+
+    // Positive floats over 24 orders of magnitude
+    max_error = 0.f;
+    for (int i = 0; i <= num_samples; ++i) {
+        const float scalar = std::pow(10.f, -12.f + 24.f * i / num_samples);
+        max_error = std::max(max_error, static_cast<float>(std::fabs(approxInvSqrt(scalar) * std::sqrt(static_cast<double>(scalar)) - 1.0)));
+    }
+    EXPECT_LE(max_error, 5e-6f);
+}
+
+// TODO: Test with changing goal position